@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/bookmarks.hpp"
+#include "payloads.hpp"
+
+/* A bookmarks file in the temporary directory holding 'n' channels */
+class bookmarks_file {
+public:
+    explicit bookmarks_file(std::size_t n)
+        : _path(make_path()),
+          _bookmarks(_path)
+    {
+        _bookmarks.add(channel_names(n));
+    }
+    
+    bookmarks_file(const bookmarks_file &other) = delete;
+    
+    ~bookmarks_file()
+    {
+        std::remove(_path.c_str());
+    }
+    
+    ::bookmarks &bookmarks()
+    {
+        return _bookmarks;
+    }
+    
+    bookmarks_file &operator=(const bookmarks_file &other) = delete;
+private:
+    static std::string make_path()
+    {
+        auto dir = std::getenv("TMPDIR");
+        auto path = std::string((dir) ? dir : "/tmp");
+        
+        return path + "/tq-bench-bookmarks-" + std::to_string(getpid());
+    }
+    
+    std::string _path;
+    ::bookmarks _bookmarks;
+};
+
+static void BM_bookmarks_read(benchmark::State &state)
+{
+    bookmarks_file file(state.range(0));
+    
+    for (auto _ : state) {
+        auto vec = file.bookmarks().get();
+        benchmark::DoNotOptimize(vec);
+    }
+    
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/* Adding a bookmark reads, sorts and writes the whole file */
+static void BM_bookmarks_write(benchmark::State &state)
+{
+    bookmarks_file file(state.range(0));
+    
+    for (auto _ : state) {
+        file.bookmarks().add("new_channel");
+        file.bookmarks().remove("new_channel");
+    }
+    
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_bookmarks_read)->Arg(10)->Arg(1000)->Arg(5000);
+BENCHMARK(BM_bookmarks_write)->Arg(10)->Arg(1000)->Arg(5000);
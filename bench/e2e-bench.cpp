@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+#include <csignal>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+#include <json/json.h>
+
+#include "../mock/http-server.hpp"
+#include "../mock/kraken-mock.hpp"
+
+#define DESC_BANDWIDTH "Limit the responses of the server to [arg] KiB/s "    \
+                       "on each connection."
+#define DESC_DELAY     "Answer every request after [arg] milliseconds."
+#define DESC_HELP      "Print this help message."
+#define DESC_JITTER    "Delay every request by up to [arg] additional "       \
+                       "milliseconds at random."
+#define DESC_OUTPUT    "Write the results to file [arg] instead of stdout."
+#define DESC_RUNS      "Measure [arg] runs of each command line."
+#define DESC_TQ        "Run the tq executable [arg]."
+#define DESC_WARMUP    "Run each command line [arg] times before measuring."
+
+namespace opt = boost::program_options;
+namespace fs = boost::filesystem;
+
+struct scenario {
+    std::string name;
+    std::size_t bookmarks;
+    std::vector<std::string> args;
+    
+    /* The command line has to exit with a failure status */
+    bool fails;
+};
+
+/* Named like the bookmarks, so every other channel is offline */
+static std::vector<std::string> stream_args(std::size_t channels)
+{
+    auto args = std::vector<std::string>({ "-S" });
+    
+    for (std::size_t i = 0; i < channels; ++i)
+        args.push_back(((i % 2) ? "offline_" : "") + 
+                       std::string("channel_") + std::to_string(i));
+                       
+    return args;
+}
+
+/* Representative command lines, each in a home directory of its own */
+static const std::vector<scenario> scenarios = {
+    { "bookmarks-10",   10,   { "-b" }, false },
+    { "bookmarks-1000", 1000, { "-b" }, false },
+    { "bookmarks-5000", 5000, { "-b" }, false },
+    { "streams-1500",   0,    stream_args(1500), false },
+    { "game-limit-100", 0,    { "-G", "Dota 2", "--limit", "100" }, false },
+    { "multi-option",   1000, { "-t", "-f", "-b", "-G", "Dota 2", 
+                                "--limit", "100" }, false },
+    { "json-error",     0,    { "-C", "status-404", "--json" }, true },
+};
+
+static void write_home(const fs::path &home, 
+                       const scenario &scenario, 
+                       unsigned short port)
+{
+    auto dir = home / ".config" / "tq";
+    
+    fs::create_directories(dir);
+    
+    /* 
+     * Responses must not be served from the cache and the rate limiter
+     * must not hold back the requests of later runs.
+     */
+    std::ofstream conf((dir / "tq.conf").c_str());
+    
+    conf << "[network]\n"
+         << "base-url   = http://127.0.0.1:" << port << "/kraken/\n"
+         << "rate-limit = 1000000\n"
+         << "rate-burst = 1000000\n\n"
+         << "[cache]\n"
+         << "enabled = false\n";
+         
+    /* Every other bookmarked channel is offline */
+    std::ofstream bookmarks((dir / "bookmarks").c_str());
+    
+    for (std::size_t i = 0; i < scenario.bookmarks; ++i) {
+        bookmarks << ((i % 2) ? "offline_" : "") 
+                  << "channel_" << i << "\n";
+    }
+    
+    if (!conf || !bookmarks)
+        throw std::runtime_error("Unable to set up \"" + home.string() + "\".");
+}
+
+/* Returns the wall time of a single run, 'ok' tells if tq succeeded */
+static double run_tq(const std::string &tq, 
+                     const fs::path &home, 
+                     const std::vector<std::string> &args,
+                     bool &ok)
+{
+    std::vector<char *> argv;
+    
+    argv.push_back(const_cast<char *>(tq.c_str()));
+    
+    for (const auto &x : args)
+        argv.push_back(const_cast<char *>(x.c_str()));
+        
+    argv.push_back(nullptr);
+    
+    auto start = std::chrono::steady_clock::now();
+    
+    auto pid = fork();
+    if (pid < 0)
+        throw std::runtime_error("fork() failed.");
+        
+    if (pid == 0) {
+        int fd = open("/dev/null", O_WRONLY);
+        
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        
+        /* Keep away from the daemon of the user */
+        setenv("HOME", home.c_str(), 1);
+        setenv("XDG_RUNTIME_DIR", home.c_str(), 1);
+        
+        execv(tq.c_str(), argv.data());
+        _exit(127);
+    }
+    
+    int status;
+    
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            throw std::runtime_error("waitpid() failed.");
+    }
+    
+    auto end = std::chrono::steady_clock::now();
+    
+    ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/* Nearest rank percentile of the sorted vector 'vec' */
+static double percentile(const std::vector<double> &vec, double p)
+{
+    auto rank = (std::size_t) std::ceil(p / 100.0 * vec.size());
+    
+    return vec[std::max(rank, (std::size_t) 1) - 1];
+}
+
+static Json::Value measure(const std::string &tq, 
+                           const fs::path &home, 
+                           const scenario &scenario, 
+                           unsigned int warmup, 
+                           unsigned int runs)
+{
+    std::vector<double> times;
+    
+    /* Runs which did not exit with the expected status */
+    unsigned int failures = 0;
+    bool ok;
+    
+    for (unsigned int i = 0; i < warmup; ++i)
+        run_tq(tq, home, scenario.args, ok);
+        
+    for (unsigned int i = 0; i < runs; ++i) {
+        auto time = run_tq(tq, home, scenario.args, ok);
+        
+        if (ok == scenario.fails)
+            ++failures;
+        else
+            times.push_back(time);
+    }
+    
+    Json::Value result;
+    Json::Value command(Json::arrayValue);
+    
+    for (const auto &x : scenario.args)
+        command.append(x);
+        
+    result["name"] = scenario.name;
+    result["command"] = command;
+    result["bookmarks"] = Json::UInt64(scenario.bookmarks);
+    result["runs"] = runs;
+    result["failures"] = failures;
+    
+    if (times.empty())
+        return result;
+        
+    std::sort(times.begin(), times.end());
+    
+    auto sum = std::accumulate(times.begin(), times.end(), 0.0);
+    auto &wall = result["wall_ms"];
+    
+    wall["min"] = times.front();
+    wall["mean"] = sum / times.size();
+    wall["p50"] = percentile(times, 50.0);
+    wall["p99"] = percentile(times, 99.0);
+    wall["max"] = times.back();
+    
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string tq(TQ_PATH);
+    std::string output;
+    unsigned int bandwidth = 0;
+    unsigned int delay = 50;
+    unsigned int jitter = 10;
+    unsigned int runs = 20;
+    unsigned int warmup = 2;
+    
+    std::string usage("Usage: ");
+    usage += argv[0];
+    usage += " [options]\n\n"
+             "Measures the wall time of representative tq command lines\n"
+             "against a local stand-in for the twitch.tv API and writes\n"
+             "the results as JSON.\n\nOptions";
+             
+    opt::options_description desc(usage);
+    
+    desc.add_options()
+        ("bandwidth", opt::value(&bandwidth), DESC_BANDWIDTH)
+        ("delay",     opt::value(&delay),     DESC_DELAY)
+        ("help,h",                            DESC_HELP)
+        ("jitter",    opt::value(&jitter),    DESC_JITTER)
+        ("output,o",  opt::value(&output),    DESC_OUTPUT)
+        ("runs,n",    opt::value(&runs),      DESC_RUNS)
+        ("tq",        opt::value(&tq),        DESC_TQ)
+        ("warmup",    opt::value(&warmup),    DESC_WARMUP);
+        
+    try {
+        opt::variables_map argv_map;
+        
+        opt::store(opt::parse_command_line(argc, argv, desc), argv_map);
+        opt::notify(argv_map);
+        
+        if (argv_map.count("help")) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        
+        if (runs == 0)
+            throw std::invalid_argument("At least one run is required.");
+            
+        kraken_mock mock(FIXTURE_DIR);
+        mock.set_delay(std::chrono::milliseconds(delay));
+        mock.set_jitter(std::chrono::milliseconds(jitter));
+        
+        auto handler = [&mock](const http_request &req) {
+            return mock.handle(req);
+        };
+        
+        http_server server(0, handler);
+        server.set_bandwidth(bandwidth * 1024ul);
+        
+        /* The server gets a process of its own, just like the real API */
+        auto server_pid = fork();
+        if (server_pid < 0)
+            throw std::runtime_error("fork() failed.");
+            
+        if (server_pid == 0) {
+            server.run();
+            _exit(EXIT_FAILURE);
+        }
+        
+        auto base = fs::temp_directory_path() / 
+                    fs::unique_path("tq-e2e-%%%%-%%%%");
+                    
+        Json::Value results(Json::arrayValue);
+        unsigned int failures = 0;
+        
+        try {
+            for (const auto &x : scenarios) {
+                auto home = base / x.name;
+                
+                std::cerr << "Measuring " << x.name << "..." << std::endl;
+                
+                write_home(home, x, server.port());
+                auto result = measure(tq, home, x, warmup, runs);
+                
+                failures += result["failures"].asUInt();
+                results.append(std::move(result));
+            }
+        } catch (...) {
+            kill(server_pid, SIGTERM);
+            fs::remove_all(base);
+            throw;
+        }
+        
+        kill(server_pid, SIGTERM);
+        waitpid(server_pid, nullptr, 0);
+        fs::remove_all(base);
+        
+        Json::Value root;
+        
+        root["tq"] = tq;
+        root["server"]["delay_ms"] = delay;
+        root["server"]["jitter_ms"] = jitter;
+        root["server"]["bandwidth_kib"] = bandwidth;
+        root["results"] = results;
+        
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "  ";
+        builder["precision"] = 3;
+        builder["precisionType"] = "decimal";
+        
+        auto str = Json::writeString(builder, root);
+        
+        if (output.empty()) {
+            std::cout << str << std::endl;
+        } else {
+            std::ofstream file(output);
+            
+            file << str << std::endl;
+            if (!file)
+                throw std::runtime_error("Unable to write \"" + output + "\".");
+        }
+        
+        /* Timings of failed runs would be meaningless */
+        if (failures > 0) {
+            std::cerr << "** Error: " << failures 
+                      << " runs of tq did not exit as expected.\n";
+            return EXIT_FAILURE;
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <json/json.h>
+
+#include "payloads.hpp"
+
+static const Json::Value &fixture(const std::string &name)
+{
+    static std::unordered_map<std::string, Json::Value> fixtures;
+    
+    auto it = fixtures.find(name);
+    if (it != fixtures.end())
+        return it->second;
+        
+    auto path = std::string(FIXTURE_DIR) + "/" + name + ".json";
+    
+    std::ifstream file(path);
+    Json::CharReaderBuilder builder;
+    Json::Value value;
+    std::string err;
+    
+    if (!file || !Json::parseFromStream(builder, file, &value, &err))
+        throw std::runtime_error("Unable to load \"" + path + "\".");
+        
+    return fixtures[name] = std::move(value);
+}
+
+static std::string to_string(const Json::Value &value)
+{
+    Json::StreamWriterBuilder builder;
+    
+    builder["indentation"] = "";
+    
+    return Json::writeString(builder, value);
+}
+
+static void rename_channel(Json::Value &channel, std::size_t i)
+{
+    auto name = "channel_" + std::to_string(i);
+    
+    channel["_id"] = Json::UInt64(1000000 + i);
+    channel["name"] = name;
+    channel["display_name"] = name;
+    channel["url"] = "https://www.twitch.tv/" + name;
+}
+
+/* The 'i'th entry of a recorded list, made unique */
+static Json::Value entry(const Json::Value &list, std::size_t i)
+{
+    auto value = list[(Json::ArrayIndex) (i % list.size())];
+    
+    if (value.isMember("_id"))
+        value["_id"] = Json::UInt64(2000000 + i);
+        
+    if (value.isMember("stream")) {
+        value["stream"]["_id"] = Json::UInt64(2000000 + i);
+        rename_channel(value["stream"]["channel"], i);
+    }
+    
+    if (value.isMember("channel"))
+        rename_channel(value["channel"], i);
+    else if (value.isMember("url"))
+        rename_channel(value, i);
+        
+    if (value.isMember("game") && value["game"].isObject())
+        value["game"]["_id"] = Json::UInt64(3000000 + i);
+        
+    return value;
+}
+
+static std::string list_payload(const std::string &name, 
+                                const std::string &key, 
+                                std::size_t n)
+{
+    auto value = fixture(name);
+    auto &list = value[key];
+    auto recorded = list;
+    
+    list = Json::Value(Json::arrayValue);
+    
+    for (std::size_t i = 0; i < n; ++i)
+        list.append(entry(recorded, i));
+        
+    return to_string(value);
+}
+
+std::string streams_payload(std::size_t n)
+{
+    return list_payload("streams", "streams", n);
+}
+
+std::string featured_payload(std::size_t n)
+{
+    return list_payload("featured", "featured", n);
+}
+
+std::string search_channels_payload(std::size_t n)
+{
+    return list_payload("search-channels", "channels", n);
+}
+
+std::string top_games_payload(std::size_t n)
+{
+    return list_payload("top", "top", n);
+}
+
+std::string bookmarks_payload(std::size_t n)
+{
+    auto value = fixture("streams");
+    auto &list = value["streams"];
+    auto recorded = list;
+    auto self = std::string("https://api.twitch.tv/kraken/streams?channel=");
+    
+    list = Json::Value(Json::arrayValue);
+    
+    for (std::size_t i = 0; i < n; ++i) {
+        self += (i > 0) ? "%2C" : "";
+        self += "channel_" + std::to_string(i);
+        
+        if (i % 2 == 0)
+            list.append(entry(recorded, i));
+    }
+    
+    self += "&limit=100&offset=0";
+    
+    value["_total"] = list.size();
+    value["_links"]["self"] = self;
+    
+    return to_string(value);
+}
+
+std::vector<std::string> channel_names(std::size_t n)
+{
+    std::vector<std::string> vec;
+    
+    vec.reserve(n);
+    
+    for (std::size_t i = 0; i < n; ++i)
+        vec.push_back("channel_" + std::to_string(i));
+        
+    return vec;
+}
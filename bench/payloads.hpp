@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PAYLOADS_HPP_
+#define _PAYLOADS_HPP_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/*
+ * Responses of realistic size for the benchmarks. They are built from 
+ * the recorded responses of the mock server by repeating the recorded
+ * entries with new ids and channel names until there are 'n' of them.
+ */
+
+std::string streams_payload(std::size_t n);
+std::string featured_payload(std::size_t n);
+std::string search_channels_payload(std::size_t n);
+std::string top_games_payload(std::size_t n);
+
+/* 
+ * The response to a query for the 'n' channels of channel_names(n).
+ * Every other channel is offline.
+ */
+std::string bookmarks_payload(std::size_t n);
+
+std::vector<std::string> channel_names(std::size_t n);
+
+#endif /* _PAYLOADS_HPP_ */
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <ostream>
+#include <streambuf>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/adapter/json-parser.hpp"
+#include "../src/adapter/query-results.hpp"
+#include "payloads.hpp"
+
+/* curl hands the body over in pieces of at most this size */
+#define CHUNK_SIZE 16384ul
+
+/* Swallows everything, so only the formatting is measured */
+class null_buffer : public std::streambuf {
+protected:
+    virtual int overflow(int c) override
+    {
+        return c;
+    }
+    
+    virtual std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+        (void) s;
+        return n;
+    }
+};
+
+static void parse(result &result, const std::string &body)
+{
+    json_parser parser(result);
+    
+    for (std::size_t i = 0; i < body.size(); i += CHUNK_SIZE)
+        parser.parse(body.data() + i, std::min(CHUNK_SIZE, body.size() - i));
+        
+    parser.finish();
+}
+
+template <typename T, std::string (*Payload)(std::size_t)>
+static void BM_parse(benchmark::State &state)
+{
+    auto body = Payload(state.range(0));
+    
+    for (auto _ : state) {
+        T result;
+        
+        parse(result, body);
+        benchmark::DoNotOptimize(result);
+    }
+    
+    state.SetBytesProcessed(state.iterations() * body.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename T, std::string (*Payload)(std::size_t), bool Verbose>
+static void BM_dump(benchmark::State &state)
+{
+    null_buffer buffer;
+    std::ostream out(&buffer);
+    T result;
+    
+    parse(result, Payload(state.range(0)));
+    
+    result.set_verbose(Verbose);
+    result.set_descriptive(true);
+    
+    for (auto _ : state)
+        result.dump(out);
+        
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename T, 
+          std::string (*Payload)(std::size_t), 
+          record_format Format>
+static void BM_dump_records(benchmark::State &state)
+{
+    null_buffer buffer;
+    std::ostream out(&buffer);
+    T result;
+    
+    parse(result, Payload(state.range(0)));
+    
+    for (auto _ : state)
+        result.dump_records(out, Format);
+        
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+#define SIZES Arg(1)->Arg(25)->Arg(100)->Arg(1000)
+
+BENCHMARK_TEMPLATE(BM_parse, streams_result, streams_payload)->SIZES;
+BENCHMARK_TEMPLATE(BM_parse, featured_streams_result, featured_payload)
+    ->SIZES;
+BENCHMARK_TEMPLATE(BM_parse, search_channels_result, search_channels_payload)
+    ->SIZES;
+BENCHMARK_TEMPLATE(BM_parse, top_games_result, top_games_payload)->SIZES;
+
+/* Includes the scan of the self link for the names of the channels */
+BENCHMARK_TEMPLATE(BM_parse, bookmarks_result, bookmarks_payload)->SIZES;
+
+BENCHMARK_TEMPLATE(BM_dump, streams_result, streams_payload, false)->SIZES;
+BENCHMARK_TEMPLATE(BM_dump, streams_result, streams_payload, true)->SIZES;
+BENCHMARK_TEMPLATE(BM_dump, featured_streams_result, featured_payload, false)
+    ->SIZES;
+BENCHMARK_TEMPLATE(BM_dump, 
+                   search_channels_result, 
+                   search_channels_payload, 
+                   false)->SIZES;
+BENCHMARK_TEMPLATE(BM_dump, 
+                   search_channels_result, 
+                   search_channels_payload, 
+                   true)->SIZES;
+BENCHMARK_TEMPLATE(BM_dump, top_games_result, top_games_payload, false)
+    ->SIZES;
+BENCHMARK_TEMPLATE(BM_dump, bookmarks_result, bookmarks_payload, false)
+    ->SIZES;
+
+BENCHMARK_TEMPLATE(BM_dump_records, 
+                   streams_result, 
+                   streams_payload, 
+                   record_format::ndjson)->SIZES;
+BENCHMARK_TEMPLATE(BM_dump_records, 
+                   streams_result, 
+                   streams_payload, 
+                   record_format::tsv)->SIZES;
+BENCHMARK_TEMPLATE(BM_dump_records, 
+                   streams_result, 
+                   streams_payload, 
+                   record_format::csv)->SIZES;
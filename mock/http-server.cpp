@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "http-server.hpp"
+
+/* Requests with larger headers are rejected */
+#define MAX_HEADER_SIZE 16384
+
+/* Responses are paced in pieces of this size if the bandwidth is limited */
+#define CHUNK_SIZE 4096ul
+
+static void throw_errno(const std::string &msg)
+{
+    char buffer[64];
+    
+    std::string err_msg = msg;
+    err_msg += " - ";
+    err_msg += strerror_r(errno, buffer, sizeof(buffer));
+    
+    throw std::runtime_error(err_msg);
+}
+
+static std::string to_lower(std::string str)
+{
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    
+    return str;
+}
+
+static std::string trim(const std::string &str)
+{
+    auto begin = str.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return std::string();
+        
+    auto end = str.find_last_not_of(" \t\r");
+    
+    return str.substr(begin, end - begin + 1);
+}
+
+static std::string url_decode(const std::string &str)
+{
+    std::string result;
+    
+    result.reserve(str.size());
+    
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        if (str[i] == '+') {
+            result += ' ';
+        } else if (str[i] == '%' && i + 2 < str.size() 
+                   && std::isxdigit(str[i + 1]) 
+                   && std::isxdigit(str[i + 2])) {
+            result += (char) std::stoi(str.substr(i + 1, 2), nullptr, 16);
+            i += 2;
+        } else {
+            result += str[i];
+        }
+    }
+    
+    return result;
+}
+
+static void parse_params(http_request &req, const std::string &query)
+{
+    std::size_t begin = 0;
+    
+    while (begin < query.size()) {
+        auto end = query.find('&', begin);
+        if (end == std::string::npos)
+            end = query.size();
+            
+        auto param = query.substr(begin, end - begin);
+        auto eq = param.find('=');
+        
+        if (eq != std::string::npos) {
+            auto key = url_decode(param.substr(0, eq));
+            req.params[key] = url_decode(param.substr(eq + 1));
+        } else if (!param.empty()) {
+            req.params[url_decode(param)] = std::string();
+        }
+        
+        begin = end + 1;
+    }
+}
+
+static bool parse_request(http_request &req, const std::string &head)
+{
+    auto end = head.find("\r\n");
+    auto line = head.substr(0, end);
+    
+    auto sp1 = line.find(' ');
+    auto sp2 = line.rfind(' ');
+    if (sp1 == std::string::npos || sp1 == sp2)
+        return false;
+        
+    req.method = line.substr(0, sp1);
+    
+    auto target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    auto query = target.find('?');
+    
+    req.path = url_decode(target.substr(0, query));
+    
+    if (query != std::string::npos)
+        parse_params(req, target.substr(query + 1));
+        
+    while (end != std::string::npos && end + 2 < head.size()) {
+        auto begin = end + 2;
+        
+        end = head.find("\r\n", begin);
+        line = head.substr(begin, end - begin);
+        
+        auto colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+            
+        auto name = to_lower(line.substr(0, colon));
+        req.headers[name] = trim(line.substr(colon + 1));
+    }
+    
+    return true;
+}
+
+static const char *reason_phrase(int status)
+{
+    switch (status) {
+    case 200:
+        return "OK";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 422:
+        return "Unprocessable Entity";
+    case 429:
+        return "Too Many Requests";
+    case 500:
+        return "Internal Server Error";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Unknown";
+    }
+}
+
+http_request::http_request()
+    : method(),
+      path(),
+      params(),
+      headers()
+{
+}
+
+http_response::http_response()
+    : status(200),
+      headers(),
+      body()
+{
+}
+
+http_server::http_server(unsigned short port, handler handler)
+    : _fd(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)),
+      _handler(std::move(handler)),
+      _bandwidth(0)
+{
+    if (_fd < 0)
+        throw_errno("socket() failed");
+        
+    struct sockaddr_in addr;
+    int on = 1;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    
+    int err = bind(_fd, (struct sockaddr *) &addr, sizeof(addr));
+    if (err < 0) {
+        close(_fd);
+        throw_errno("bind() to port " + std::to_string(port) + " failed");
+    }
+    
+    err = listen(_fd, 64);
+    if (err < 0) {
+        close(_fd);
+        throw_errno("listen() failed");
+    }
+}
+
+http_server::~http_server()
+{
+    close(_fd);
+}
+
+unsigned short http_server::port() const
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    
+    int err = getsockname(_fd, (struct sockaddr *) &addr, &len);
+    if (err < 0)
+        throw_errno("getsockname() failed");
+        
+    return ntohs(addr.sin_port);
+}
+
+void http_server::set_bandwidth(std::size_t bytes)
+{
+    _bandwidth = bytes;
+}
+
+void http_server::run()
+{
+    while (true) {
+        int fd = accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+                
+            throw_errno("accept() failed");
+        }
+        
+        std::thread(&http_server::serve, this, fd).detach();
+    }
+}
+
+void http_server::serve(int fd) const
+{
+    std::string buffer;
+    char data[4096];
+    
+    while (true) {
+        auto end = buffer.find("\r\n\r\n");
+        
+        if (end == std::string::npos) {
+            if (buffer.size() > MAX_HEADER_SIZE)
+                break;
+                
+            auto n = recv(fd, data, sizeof(data), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+                
+            if (n <= 0)
+                break;
+                
+            buffer.append(data, n);
+            continue;
+        }
+        
+        http_request req;
+        http_response res;
+        
+        auto ok = parse_request(req, buffer.substr(0, end + 2));
+        buffer.erase(0, end + 4);
+        
+        if (!ok)
+            res.status = 400;
+        else if (req.method != "GET")
+            res.status = 404;
+        else
+            res = _handler(req);
+            
+        std::string str;
+        
+        str.reserve(res.body.size() + 256);
+        str += "HTTP/1.1 ";
+        str += std::to_string(res.status);
+        str += ' ';
+        str += reason_phrase(res.status);
+        str += "\r\nContent-Length: ";
+        str += std::to_string(res.body.size());
+        str += "\r\n";
+        
+        for (const auto &x : res.headers) {
+            str += x.first;
+            str += ": ";
+            str += x.second;
+            str += "\r\n";
+        }
+        
+        str += "\r\n";
+        str += res.body;
+        
+        if (!send_all(fd, str))
+            break;
+            
+        if (to_lower(req.headers["connection"]) == "close")
+            break;
+    }
+    
+    close(fd);
+}
+
+bool http_server::send_all(int fd, const std::string &str) const
+{
+    auto start = std::chrono::steady_clock::now();
+    auto p = str.data();
+    auto size = str.size();
+    std::size_t sent = 0;
+    
+    while (size > 0) {
+        auto len = (_bandwidth > 0) ? std::min(size, CHUNK_SIZE) : size;
+        
+        auto n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+                
+            return false;
+        }
+        
+        p += n;
+        size -= n;
+        sent += n;
+        
+        if (_bandwidth > 0) {
+            /* Wait until the data sent so far would have arrived */
+            auto usec = sent * 1000000ull / _bandwidth;
+            
+            std::this_thread::sleep_until(start + 
+                                          std::chrono::microseconds(usec));
+        }
+    }
+    
+    return true;
+}
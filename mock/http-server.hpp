@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HTTP_SERVER_HPP_
+#define _HTTP_SERVER_HPP_
+
+#include <string>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+
+struct http_request {
+    http_request();
+    
+    std::string method;
+    std::string path;
+    
+    /* The decoded query parameters and the headers with lower case names */
+    std::unordered_map<std::string, std::string> params;
+    std::unordered_map<std::string, std::string> headers;
+};
+
+struct http_response {
+    http_response();
+    
+    int status;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+/*
+ * A small HTTP/1.1 server listening on the loopback interface. Each 
+ * connection is served by a thread of its own and may be kept alive for
+ * any number of requests. It is just good enough to stand in for the
+ * twitch.tv API while testing tq. Port 0 lets the system pick a free
+ * port.
+ */
+class http_server {
+public:
+    typedef std::function<http_response(const http_request &)> handler;
+    
+    http_server(unsigned short port, handler handler);
+    http_server(const http_server &other) = delete;
+    ~http_server();
+    
+    /* The port the server listens on, even if it was picked by the system */
+    unsigned short port() const;
+    
+    /* 
+     * Limits the rate at which each connection sends its responses to
+     * 'bytes' per second. Zero means unlimited.
+     */
+    void set_bandwidth(std::size_t bytes);
+    
+    /* Never returns */
+    void run();
+    
+    http_server &operator=(const http_server &other) = delete;
+private:
+    void serve(int fd) const;
+    bool send_all(int fd, const std::string &str) const;
+    
+    int _fd;
+    handler _handler;
+    std::size_t _bandwidth;
+};
+
+#endif /* _HTTP_SERVER_HPP_ */
@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <stdexcept>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <cctype>
+
+#include "kraken-mock.hpp"
+
+#define API_PREFIX "/kraken/"
+
+/* Every repetition of the recorded list entries gets ids of its own */
+#define ID_STRIDE 1000000000ULL
+
+static const char *fixture_names[] = {
+    "channel",
+    "error-404",
+    "error-422",
+    "error-429",
+    "error-500",
+    "error-503",
+    "featured",
+    "search-channels",
+    "search-games",
+    "search-streams",
+    "streams",
+    "top",
+    "user",
+};
+
+static unsigned int to_uint(const std::string &str, unsigned int def)
+{
+    try {
+        return (str.empty()) ? def : std::stoul(str);
+    } catch (std::exception &e) {
+        return def;
+    }
+}
+
+static std::string param(const http_request &req, const std::string &key)
+{
+    auto it = req.params.find(key);
+    
+    return (it != req.params.end()) ? it->second : std::string();
+}
+
+static void shift_ids(Json::Value &value, unsigned long long offset)
+{
+    if (value.isArray()) {
+        for (auto &x : value)
+            shift_ids(x, offset);
+    } else if (value.isObject()) {
+        for (const auto &x : value.getMemberNames()) {
+            auto &member = value[x];
+            
+            if (x == "_id" && member.isIntegral())
+                member = Json::UInt64(member.asUInt64() + offset);
+            else
+                shift_ids(member, offset);
+        }
+    }
+}
+
+/* Like the real API, only the display name keeps the requested case */
+static void rename_channel(Json::Value &channel, const std::string &name)
+{
+    auto lower = name;
+    
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    
+    auto id = std::hash<std::string>()(lower) % ID_STRIDE;
+    
+    channel["_id"] = Json::UInt64(id);
+    channel["name"] = lower;
+    channel["display_name"] = name;
+    channel["url"] = "https://www.twitch.tv/" + lower;
+    channel["_links"]["self"] = "https://api.twitch.tv/kraken/channels/"
+                                + lower;
+}
+
+static int error_status(const std::string &name)
+{
+    static const std::string prefix = "status-";
+    
+    if (name.compare(0, prefix.size(), prefix) != 0)
+        return 0;
+        
+    return to_uint(name.substr(prefix.size()), 0);
+}
+
+kraken_mock::kraken_mock(const std::string &fixture_dir)
+    : _fixtures(),
+      _delay(0),
+      _slow_delay(1000),
+      _jitter(0),
+      _max_age(0)
+{
+    for (auto x : fixture_names) {
+        auto path = fixture_dir + "/" + x + ".json";
+        
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("Unable to open \"" + path + "\".");
+            
+        Json::CharReaderBuilder builder;
+        Json::Value value;
+        std::string err;
+        
+        if (!Json::parseFromStream(builder, file, &value, &err))
+            throw std::runtime_error("Invalid fixture \"" + path + "\".");
+            
+        _fixtures[x] = std::move(value);
+    }
+}
+
+void kraken_mock::set_delay(std::chrono::milliseconds delay)
+{
+    _delay = delay;
+}
+
+void kraken_mock::set_slow_delay(std::chrono::milliseconds delay)
+{
+    _slow_delay = delay;
+}
+
+void kraken_mock::set_jitter(std::chrono::milliseconds jitter)
+{
+    _jitter = jitter;
+}
+
+void kraken_mock::set_max_age(unsigned int max_age)
+{
+    _max_age = max_age;
+}
+
+http_response kraken_mock::handle(const http_request &req) const
+{
+    auto delay = _delay;
+    
+    if (req.path.find("slow") != std::string::npos)
+        delay += _slow_delay;
+        
+    for (const auto &x : req.params) {
+        if (x.second.find("slow") != std::string::npos)
+            delay += _slow_delay;
+    }
+    
+    if (_jitter.count() > 0) {
+        /* Every connection is served by a thread of its own */
+        static thread_local std::mt19937 engine(std::random_device{}());
+        
+        std::uniform_int_distribution<long> dist(0, _jitter.count());
+        delay += std::chrono::milliseconds(dist(engine));
+    }
+    
+    std::this_thread::sleep_for(delay);
+    
+    auto res = route(req);
+    
+    /* The body is good enough as its own entity tag */
+    auto etag = "\"" + std::to_string(std::hash<std::string>()(res.body));
+    etag += '"';
+    
+    auto it = req.headers.find("if-none-match");
+    if (res.status == 200 && it != req.headers.end() && it->second == etag) {
+        res.status = 304;
+        res.body.clear();
+    }
+    
+    res.headers.emplace_back("ETag", std::move(etag));
+    
+    return res;
+}
+
+http_response kraken_mock::route(const http_request &req) const
+{
+    static const std::string prefix = API_PREFIX;
+    
+    if (req.path.compare(0, prefix.size(), prefix) != 0)
+        return error(404);
+        
+    auto path = req.path.substr(prefix.size());
+    auto slash = path.find('/');
+    auto endpoint = path.substr(0, slash);
+    auto name = (slash != std::string::npos) ? path.substr(slash + 1) : "";
+    auto query = param(req, "q");
+    
+    if (error_status(name))
+        return error(error_status(name));
+        
+    if (error_status(query))
+        return error(error_status(query));
+        
+    try {
+        if (endpoint == "channels" && !name.empty())
+            return respond(channels(name));
+        else if (endpoint == "users" && !name.empty())
+            return respond(users(name));
+        else if (path == "streams")
+            return respond(streams(req));
+        else if (path == "streams/featured")
+            return respond(page("featured", "featured", req));
+        else if (path == "search/channels")
+            return respond(page("search-channels", "channels", req));
+        else if (path == "search/games")
+            return respond(search_games(req));
+        else if (path == "search/streams")
+            return respond(page("search-streams", "streams", req));
+        else if (path == "games/top")
+            return respond(page("top", "top", req));
+    } catch (std::invalid_argument &e) {
+        return error(422);
+    }
+    
+    return error(404);
+}
+
+const Json::Value &kraken_mock::fixture(const std::string &name) const
+{
+    return _fixtures.at(name);
+}
+
+Json::Value kraken_mock::channels(const std::string &name) const
+{
+    auto value = fixture("channel");
+    
+    rename_channel(value, name);
+    
+    return value;
+}
+
+Json::Value kraken_mock::users(const std::string &name) const
+{
+    auto value = fixture("user");
+    
+    value["name"] = name;
+    value["display_name"] = name;
+    value["_links"]["self"] = "https://api.twitch.tv/kraken/users/" + name;
+    
+    return value;
+}
+
+Json::Value kraken_mock::streams(const http_request &req) const
+{
+    static const std::string offline = "offline";
+    
+    auto channels = param(req, "channel");
+    if (channels.empty()) {
+        auto value = page("streams", "streams", req);
+        auto game = param(req, "game");
+        
+        if (!game.empty()) {
+            for (auto &x : value["streams"]) {
+                x["game"] = game;
+                x["channel"]["game"] = game;
+            }
+        }
+        
+        return value;
+    }
+    
+    const auto &recorded = fixture("streams")["streams"];
+    
+    auto value = fixture("streams");
+    auto &streams = value["streams"];
+    auto self = std::string("https://api.twitch.tv/kraken/streams?channel=");
+    
+    streams = Json::Value(Json::arrayValue);
+    
+    std::istringstream list(channels);
+    std::string name;
+    Json::ArrayIndex i = 0;
+    
+    while (std::getline(list, name, ',')) {
+        if (i > 0)
+            self += "%2C";
+            
+        self += name;
+        
+        auto stream = recorded[i++ % recorded.size()];
+        
+        if (name.compare(0, offline.size(), offline) == 0)
+            continue;
+            
+        auto link = "https://api.twitch.tv/kraken/streams/" + name;
+        
+        stream["_id"] = Json::UInt64(std::hash<std::string>()(name));
+        stream["_links"]["self"] = std::move(link);
+        rename_channel(stream["channel"], name);
+        
+        streams.append(std::move(stream));
+    }
+    
+    self += "&limit=" + param(req, "limit");
+    self += "&offset=" + param(req, "offset");
+    
+    value["_total"] = streams.size();
+    value["_links"]["self"] = self;
+    
+    return value;
+}
+
+Json::Value kraken_mock::search_games(const http_request &req) const
+{
+    auto value = fixture("search-games");
+    auto query = param(req, "q");
+    
+    value["_links"]["self"] = "https://api.twitch.tv/kraken/search/games?q=" 
+                              + query + "&type=suggest";
+                              
+    return value;
+}
+
+Json::Value kraken_mock::page(const std::string &name, 
+                              const std::string &key,
+                              const http_request &req) const
+{
+    auto limit = to_uint(param(req, "limit"), 25);
+    auto offset = to_uint(param(req, "offset"), 0);
+    
+    if (limit == 0 || limit > 100)
+        throw std::invalid_argument("limit");
+        
+    const auto &recorded = fixture(name)[key];
+    
+    auto value = fixture(name);
+    auto &list = value[key];
+    auto total = value.get("_total", 1000).asUInt();
+    auto end = std::min(offset + limit, total);
+    
+    list = Json::Value(Json::arrayValue);
+    
+    /* Pages of any size are filled by repeating the recorded entries */
+    for (auto i = offset; i < end && !recorded.empty(); ++i) {
+        auto entry = recorded[i % recorded.size()];
+        
+        shift_ids(entry, ID_STRIDE * (i / recorded.size()));
+        list.append(std::move(entry));
+    }
+    
+    return value;
+}
+
+http_response kraken_mock::error(int status) const
+{
+    auto name = "error-" + std::to_string(status);
+    
+    if (_fixtures.find(name) == _fixtures.end())
+        name = "error-404";
+        
+    auto res = respond(fixture(name));
+    
+    res.status = fixture(name)["status"].asInt();
+    
+    if (res.status == 429)
+        res.headers.emplace_back("Retry-After", "1");
+        
+    return res;
+}
+
+http_response kraken_mock::respond(const Json::Value &value) const
+{
+    Json::StreamWriterBuilder builder;
+    http_response res;
+    
+    builder["indentation"] = "";
+    
+    res.body = Json::writeString(builder, value);
+    res.headers.emplace_back("Content-Type", 
+                             "application/json; charset=utf-8");
+                             
+    if (_max_age > 0) {
+        auto str = "public, max-age=" + std::to_string(_max_age);
+        res.headers.emplace_back("Cache-Control", std::move(str));
+    }
+    
+    return res;
+}
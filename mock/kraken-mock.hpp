@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _KRAKEN_MOCK_HPP_
+#define _KRAKEN_MOCK_HPP_
+
+#include <string>
+#include <chrono>
+#include <unordered_map>
+
+#include <json/json.h>
+
+#include "http-server.hpp"
+
+/*
+ * Answers requests for every endpoint tq uses with the recorded responses
+ * in a fixture directory. The recorded responses are adjusted to the 
+ * request where this matters: names are filled in and list responses
+ * are cut to the requested page, repeating the recorded entries with 
+ * new ids if necessary.
+ *
+ * A few names trigger special answers: a channel, user or search query 
+ * named "status-<code>" gets the recorded error payload "error-<code>",
+ * a name containing "slow" is answered with an additional delay and 
+ * channels whose name starts with "offline" are never live.
+ */
+class kraken_mock {
+public:
+    explicit kraken_mock(const std::string &fixture_dir);
+    
+    /* Time taken to answer any request */
+    void set_delay(std::chrono::milliseconds delay);
+    
+    /* Additional time taken for "slow" requests */
+    void set_slow_delay(std::chrono::milliseconds delay);
+    
+    /* Adds a random delay of up to 'jitter' to every request */
+    void set_jitter(std::chrono::milliseconds jitter);
+    
+    /* Responses may be cached by the client for 'max_age' seconds */
+    void set_max_age(unsigned int max_age);
+    
+    http_response handle(const http_request &req) const;
+private:
+    http_response route(const http_request &req) const;
+    const Json::Value &fixture(const std::string &name) const;
+    
+    Json::Value channels(const std::string &name) const;
+    Json::Value users(const std::string &name) const;
+    Json::Value streams(const http_request &req) const;
+    Json::Value search_games(const http_request &req) const;
+    Json::Value page(const std::string &name, 
+                     const std::string &key,
+                     const http_request &req) const;
+                     
+    http_response error(int status) const;
+    http_response respond(const Json::Value &value) const;
+    
+    std::unordered_map<std::string, Json::Value> _fixtures;
+    std::chrono::milliseconds _delay;
+    std::chrono::milliseconds _slow_delay;
+    std::chrono::milliseconds _jitter;
+    unsigned int _max_age;
+};
+
+#endif /* _KRAKEN_MOCK_HPP_ */
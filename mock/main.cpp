@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include <boost/program_options.hpp>
+
+#include "http-server.hpp"
+#include "kraken-mock.hpp"
+
+#define DESC_BANDWIDTH  "Send responses with at most [arg] KiB/s on each "  \
+                        "connection."
+#define DESC_DELAY      "Answer every request after [arg] milliseconds."
+#define DESC_FIXTURES   "Load the recorded responses from directory [arg]."
+#define DESC_HELP       "Print this help message."
+#define DESC_JITTER     "Delay every request by up to [arg] additional "    \
+                        "milliseconds at random."
+#define DESC_MAX_AGE    "Allow clients to cache responses for [arg] seconds."
+#define DESC_PORT       "Listen on port [arg] of the loopback interface."
+#define DESC_SLOW_DELAY "Answer requests for names containing \"slow\" "    \
+                        "after an additional [arg] milliseconds."
+                        
+namespace opt = boost::program_options;
+
+int main(int argc, char *argv[])
+{
+    std::string fixture_dir(FIXTURE_DIR);
+    unsigned short port = 8089;
+    unsigned int bandwidth = 0;
+    unsigned int delay = 0;
+    unsigned int jitter = 0;
+    unsigned int slow_delay = 1000;
+    unsigned int max_age = 0;
+    
+    std::string usage("Usage: ");
+    usage += argv[0];
+    usage += " [options]\n\n"
+             "Serves recorded twitch.tv API responses for testing tq. Set\n"
+             "\"base-url = http://127.0.0.1:<port>/kraken/\" in the [network]\n"
+             "section of tq's configuration to use it.\n\nOptions";
+             
+    opt::options_description desc(usage);
+    
+    desc.add_options()
+        ("bandwidth",  opt::value(&bandwidth),   DESC_BANDWIDTH)
+        ("delay",      opt::value(&delay),       DESC_DELAY)
+        ("fixtures",   opt::value(&fixture_dir), DESC_FIXTURES)
+        ("help,h",                               DESC_HELP)
+        ("jitter",     opt::value(&jitter),      DESC_JITTER)
+        ("max-age",    opt::value(&max_age),     DESC_MAX_AGE)
+        ("port,p",     opt::value(&port),        DESC_PORT)
+        ("slow-delay", opt::value(&slow_delay),  DESC_SLOW_DELAY);
+        
+    try {
+        opt::variables_map argv_map;
+        
+        opt::store(opt::parse_command_line(argc, argv, desc), argv_map);
+        opt::notify(argv_map);
+        
+        if (argv_map.count("help")) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        
+        kraken_mock mock(fixture_dir);
+        mock.set_delay(std::chrono::milliseconds(delay));
+        mock.set_slow_delay(std::chrono::milliseconds(slow_delay));
+        mock.set_jitter(std::chrono::milliseconds(jitter));
+        mock.set_max_age(max_age);
+        
+        auto handler = [&mock](const http_request &req) {
+            return mock.handle(req);
+        };
+        
+        http_server server(port, handler);
+        server.set_bandwidth(bandwidth * 1024ul);
+        
+        std::cout << "Listening on http://127.0.0.1:" << port << "/kraken/"
+                  << std::endl;
+                  
+        server.run();
+    } catch (std::exception &e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <utility>
+#include <cstdlib>
+#include <cerrno>
+
+#include "json-builder.hpp"
+
+json_builder::json_builder()
+    : _value(),
+      _stack(),
+      _key()
+{
+    _stack.reserve(16);
+}
+
+Json::Value &json_builder::value()
+{
+    return _value;
+}
+
+void json_builder::begin_object()
+{
+    _stack.push_back(&add(Json::Value(Json::objectValue)));
+}
+
+void json_builder::end_object()
+{
+    _stack.pop_back();
+}
+
+void json_builder::begin_array()
+{
+    _stack.push_back(&add(Json::Value(Json::arrayValue)));
+}
+
+void json_builder::end_array()
+{
+    _stack.pop_back();
+}
+
+void json_builder::key(const std::string &str)
+{
+    _key = str;
+}
+
+void json_builder::string(const std::string &str)
+{
+    add(Json::Value(str));
+}
+
+void json_builder::number(const std::string &str)
+{
+    auto is_real = str.find_first_of(".eE") != std::string::npos;
+    
+    /* Same representation as chosen by Json::Reader */
+    if (!is_real) {
+        errno = 0;
+        
+        if (str[0] == '-') {
+            auto val = std::strtoll(str.c_str(), nullptr, 10);
+            if (errno != ERANGE) {
+                add(Json::Value((Json::LargestInt) val));
+                return;
+            }
+        } else {
+            auto val = std::strtoull(str.c_str(), nullptr, 10);
+            if (errno != ERANGE) {
+                if (val <= (unsigned long long) Json::Value::maxInt)
+                    add(Json::Value((Json::LargestInt) val));
+                else
+                    add(Json::Value((Json::LargestUInt) val));
+                return;
+            }
+        }
+    }
+    
+    add(Json::Value(std::strtod(str.c_str(), nullptr)));
+}
+
+void json_builder::boolean(bool val)
+{
+    add(Json::Value(val));
+}
+
+void json_builder::null()
+{
+    add(Json::Value());
+}
+
+Json::Value &json_builder::add(Json::Value &&val)
+{
+    if (_stack.empty()) {
+        _value = std::move(val);
+        return _value;
+    }
+    
+    auto &parent = *_stack.back();
+    
+    if (parent.isArray())
+        return parent.append(std::move(val));
+        
+    auto &member = parent[_key];
+    member = std::move(val);
+    
+    return member;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _JSON_BUILDER_HPP_
+#define _JSON_BUILDER_HPP_
+
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include "json-parser.hpp"
+
+/* Assembles the events of a json_parser into a Json::Value */
+class json_builder : public json_parser::handler {
+public:
+    json_builder();
+    json_builder(const json_builder &other) = delete;
+    
+    Json::Value &value();
+    
+    virtual void begin_object() override;
+    virtual void end_object() override;
+    virtual void begin_array() override;
+    virtual void end_array() override;
+    
+    virtual void key(const std::string &str) override;
+    virtual void string(const std::string &str) override;
+    virtual void number(const std::string &str) override;
+    virtual void boolean(bool val) override;
+    virtual void null() override;
+    
+    json_builder &operator=(const json_builder &other) = delete;
+private:
+    Json::Value &add(Json::Value &&val);
+    
+    Json::Value _value;
+    std::vector<Json::Value *> _stack;
+    std::string _key;
+};
+
+#endif /* _JSON_BUILDER_HPP_ */
@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <cstring>
+
+#include "json-parser.hpp"
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static bool is_number(char c)
+{
+    return (c >= '0' && c <= '9') || (c != '\0' && std::strchr("+-.eE", c));
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+        
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+        
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+        
+    return -1;
+}
+
+json_parser::json_parser(handler &handler)
+    : _handler(handler),
+      _stack(),
+      _token(),
+      _offset(0),
+      _codepoint(0),
+      _surrogate(0),
+      _digits(0),
+      _key(false),
+      _state(STATE_VALUE)
+{
+    _stack.reserve(16);
+    _token.reserve(256);
+}
+
+void json_parser::parse(const std::string &str)
+{
+    parse(str.data(), str.size());
+}
+
+void json_parser::parse(const char *data, std::size_t size)
+{
+    std::size_t i = 0;
+    
+    while (i < size) {
+        char c = data[i];
+        
+        switch (_state) {
+        case STATE_STRING: {
+            /* Copy everything up to the next quote or escape at once */
+            auto begin = i;
+            
+            while (i < size && data[i] != '"' && data[i] != '\\')
+                ++i;
+                
+            _token.append(data + begin, i - begin);
+            
+            if (i == size)
+                break;
+                
+            if (data[i] == '"')
+                end_string();
+            else
+                _state = STATE_ESCAPE;
+                
+            ++i;
+            break;
+        }
+        case STATE_ESCAPE:
+            switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                _token += c;
+                break;
+            case 'b':
+                _token += '\b';
+                break;
+            case 'f':
+                _token += '\f';
+                break;
+            case 'n':
+                _token += '\n';
+                break;
+            case 'r':
+                _token += '\r';
+                break;
+            case 't':
+                _token += '\t';
+                break;
+            case 'u':
+                _codepoint = 0;
+                _digits = 0;
+                _state = STATE_UNICODE;
+                ++i;
+                continue;
+            default:
+                fail("invalid escape sequence", i);
+            }
+            
+            _state = STATE_STRING;
+            ++i;
+            break;
+        case STATE_UNICODE: {
+            auto val = hex_value(c);
+            if (val < 0)
+                fail("invalid unicode escape sequence", i);
+                
+            _codepoint = (_codepoint << 4) | val;
+            
+            if (++_digits == 4) {
+                append_codepoint(_codepoint);
+                _state = STATE_STRING;
+            }
+            
+            ++i;
+            break;
+        }
+        case STATE_NUMBER:
+            if (is_number(c)) {
+                _token += c;
+                ++i;
+            } else {
+                /* 'c' is not part of the number and is looked at again */
+                end_number(i);
+            }
+            break;
+        case STATE_LITERAL:
+            if (c >= 'a' && c <= 'z') {
+                _token += c;
+                ++i;
+            } else {
+                end_literal(i);
+            }
+            break;
+        default:
+            if (is_space(c)) {
+                ++i;
+                break;
+            }
+            
+            switch (_state) {
+            case STATE_VALUE:
+                begin_value(c, i);
+                break;
+            case STATE_ARRAY_START:
+                if (c == ']')
+                    end_container(c, i);
+                else
+                    begin_value(c, i);
+                break;
+            case STATE_OBJECT_START:
+                if (c == '}') {
+                    end_container(c, i);
+                    break;
+                }
+                /* fall through */
+            case STATE_KEY:
+                if (c != '"')
+                    fail("expected object key", i);
+                    
+                _token.clear();
+                _key = true;
+                _state = STATE_STRING;
+                break;
+            case STATE_COLON:
+                if (c != ':')
+                    fail("expected ':'", i);
+                    
+                _state = STATE_VALUE;
+                break;
+            case STATE_NEXT:
+                if (c == ',')
+                    _state = (_stack.back() == '{') ? STATE_KEY : STATE_VALUE;
+                else
+                    end_container(c, i);
+                break;
+            default:
+                fail("unexpected data after the end of the document", i);
+            }
+            
+            ++i;
+            break;
+        }
+    }
+    
+    _offset += size;
+}
+
+void json_parser::finish()
+{
+    if (_state == STATE_NUMBER)
+        end_number(0);
+    else if (_state == STATE_LITERAL)
+        end_literal(0);
+        
+    if (_state != STATE_DONE)
+        fail("unexpected end of document", 0);
+}
+
+void json_parser::begin_value(char c, std::size_t i)
+{
+    switch (c) {
+    case '{':
+        _handler.begin_object();
+        _stack.push_back('{');
+        _state = STATE_OBJECT_START;
+        break;
+    case '[':
+        _handler.begin_array();
+        _stack.push_back('[');
+        _state = STATE_ARRAY_START;
+        break;
+    case '"':
+        _token.clear();
+        _key = false;
+        _state = STATE_STRING;
+        break;
+    case 't':
+    case 'f':
+    case 'n':
+        _token.assign(1, c);
+        _state = STATE_LITERAL;
+        break;
+    default:
+        if (c != '-' && (c < '0' || c > '9'))
+            fail("unexpected character", i);
+            
+        _token.assign(1, c);
+        _state = STATE_NUMBER;
+        break;
+    }
+}
+
+void json_parser::end_container(char c, std::size_t i)
+{
+    if (c == '}' && _stack.back() == '{')
+        _handler.end_object();
+    else if (c == ']' && _stack.back() == '[')
+        _handler.end_array();
+    else
+        fail("expected ',' or closing bracket", i);
+        
+    _stack.pop_back();
+    end_value();
+}
+
+void json_parser::end_value()
+{
+    _state = (_stack.empty()) ? STATE_DONE : STATE_NEXT;
+}
+
+void json_parser::end_string()
+{
+    _surrogate = 0;
+    
+    if (_key) {
+        _handler.key(_token);
+        _state = STATE_COLON;
+        return;
+    }
+    
+    _handler.string(_token);
+    end_value();
+}
+
+void json_parser::end_number(std::size_t i)
+{
+    if (_token == "-")
+        fail("invalid number", i);
+        
+    _handler.number(_token);
+    end_value();
+}
+
+void json_parser::end_literal(std::size_t i)
+{
+    if (_token == "true")
+        _handler.boolean(true);
+    else if (_token == "false")
+        _handler.boolean(false);
+    else if (_token == "null")
+        _handler.null();
+    else
+        fail("invalid literal", i);
+        
+    end_value();
+}
+
+void json_parser::append_codepoint(unsigned int c)
+{
+    /* UTF-16 surrogate pairs are combined, unpaired ones dropped */
+    if (c >= 0xd800 && c <= 0xdbff) {
+        _surrogate = c;
+        return;
+    }
+    
+    if (c >= 0xdc00 && c <= 0xdfff) {
+        if (!_surrogate)
+            return;
+            
+        c = 0x10000 + ((_surrogate - 0xd800) << 10) + (c - 0xdc00);
+    }
+    
+    _surrogate = 0;
+    
+    if (c < 0x80) {
+        _token += (char) c;
+    } else if (c < 0x800) {
+        _token += (char) (0xc0 | (c >> 6));
+        _token += (char) (0x80 | (c & 0x3f));
+    } else if (c < 0x10000) {
+        _token += (char) (0xe0 | (c >> 12));
+        _token += (char) (0x80 | ((c >> 6) & 0x3f));
+        _token += (char) (0x80 | (c & 0x3f));
+    } else {
+        _token += (char) (0xf0 | (c >> 18));
+        _token += (char) (0x80 | ((c >> 12) & 0x3f));
+        _token += (char) (0x80 | ((c >> 6) & 0x3f));
+        _token += (char) (0x80 | (c & 0x3f));
+    }
+}
+
+void json_parser::fail(const char *msg, std::size_t i) const
+{
+    std::string err("Failed to parse json response - ");
+    err += msg;
+    err += " at offset ";
+    err += std::to_string(_offset + i);
+    
+    throw std::runtime_error(err);
+}
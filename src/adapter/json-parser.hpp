@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _JSON_PARSER_HPP_
+#define _JSON_PARSER_HPP_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/*
+ * An incremental (push) JSON parser. The document may be passed in 
+ * chunks of any size, e.g. exactly as they are received from the 
+ * network, and is reported to the handler as a sequence of events
+ * without ever holding the complete text.
+ */
+class json_parser {
+public:
+    class handler {
+    public:
+        virtual ~handler() = default;
+        
+        virtual void begin_object() = 0;
+        virtual void end_object() = 0;
+        virtual void begin_array() = 0;
+        virtual void end_array() = 0;
+        
+        virtual void key(const std::string &str) = 0;
+        virtual void string(const std::string &str) = 0;
+        virtual void number(const std::string &str) = 0;
+        virtual void boolean(bool val) = 0;
+        virtual void null() = 0;
+    };
+    
+    explicit json_parser(handler &handler);
+    json_parser(const json_parser &other) = delete;
+    
+    void parse(const char *data, std::size_t size);
+    void parse(const std::string &str);
+    
+    /* Throws if the document is incomplete */
+    void finish();
+    
+    json_parser &operator=(const json_parser &other) = delete;
+private:
+    enum state {
+        STATE_VALUE,
+        STATE_ARRAY_START,
+        STATE_OBJECT_START,
+        STATE_KEY,
+        STATE_COLON,
+        STATE_NEXT,
+        STATE_DONE,
+        STATE_STRING,
+        STATE_ESCAPE,
+        STATE_UNICODE,
+        STATE_NUMBER,
+        STATE_LITERAL,
+    };
+    
+    void begin_value(char c, std::size_t i);
+    void end_container(char c, std::size_t i);
+    void end_value();
+    void end_string();
+    void end_number(std::size_t i);
+    void end_literal(std::size_t i);
+    void append_codepoint(unsigned int c);
+    
+    [[noreturn]] void fail(const char *msg, std::size_t i) const;
+    
+    handler &_handler;
+    std::vector<char> _stack;
+    std::string _token;
+    std::size_t _offset;
+    unsigned int _codepoint;
+    unsigned int _surrogate;
+    unsigned int _digits;
+    bool _key;
+    enum state _state;
+};
+
+#endif /* _JSON_PARSER_HPP_ */
@@ -18,8 +18,345 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
 #include "query-adapter.hpp"
+#include "../run-stats.hpp"
+
+/* The server does not return more than this many items per request */
+#define PAGE_SIZE 100u
+
+/* The server does not return any items beyond this offset */
+#define MAX_OFFSET 900u
+
+static query_adapter::result_future ready(std::unique_ptr<result> res)
+{
+    std::promise<std::unique_ptr<result>> promise;
+    
+    promise.set_value(std::move(res));
+    
+    return promise.get_future();
+}
+
+static query_adapter::result_future failed(std::exception_ptr ptr)
+{
+    std::promise<std::unique_ptr<result>> promise;
+    
+    promise.set_exception(ptr);
+    
+    return promise.get_future();
+}
+
+/* Runs a query with a completion and returns the future of its result */
+template <typename F>
+static query_adapter::result_future with_future(F start)
+{
+    typedef std::promise<std::unique_ptr<result>> promise_type;
+    
+    auto promise = std::make_shared<promise_type>();
+    auto future = promise->get_future();
+    
+    start([promise](query_adapter::result_future res) {
+        try {
+            promise->set_value(res.get());
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    
+    return future;
+}
+
+/* 
+ * Collects the pages of a query, which are fetched concurrently, and 
+ * merges them in order into a single result. The query is completed
+ * once the last page was received or as soon as one of them failed.
+ */
+template <typename T>
+class query_adapter::page_collector {
+public:
+    page_collector(std::size_t pages, completion done);
+    page_collector(const page_collector &other) = delete;
+    virtual ~page_collector() = default;
+    
+    void complete(std::size_t page, std::unique_ptr<T> res);
+    void fail(std::exception_ptr ptr);
+    
+    page_collector &operator=(const page_collector &other) = delete;
+protected:
+    /* Receive the merged result or the failure of the query */
+    virtual void finish(std::unique_ptr<result> res);
+    virtual void abort(std::exception_ptr ptr);
+private:
+    std::mutex _mutex;
+    completion _completion;
+    std::vector<std::unique_ptr<T>> _pages;
+    std::size_t _pending;
+    bool _done;
+};
+
+template <typename T>
+query_adapter::page_collector<T>::page_collector(std::size_t pages, 
+                                                 completion done)
+    : _mutex(),
+      _completion(std::move(done)),
+      _pages(pages),
+      _pending(pages),
+      _done(false)
+{
+}
+
+template <typename T>
+void query_adapter::page_collector<T>::complete(std::size_t page, 
+                                                std::unique_ptr<T> res)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    _pages[page] = std::move(res);
+    
+    if (--_pending > 0 || _done)
+        return;
+        
+    _done = true;
+    
+    /* An error message of any page makes the whole query fail */
+    for (const auto &x : _pages) {
+        if (!x->error().error.empty()) {
+            auto res = std::make_unique<error_result>(x->error());
+            
+            /* The raw JSON of the error message is printed instead */
+            res->merge(*x);
+            finish(std::move(res));
+            return;
+        }
+    }
+    
+    auto &first = _pages.front();
+    
+    for (std::size_t i = 1; i < _pages.size(); ++i)
+        first->merge(*_pages[i]);
+        
+    finish(std::move(first));
+}
+
+template <typename T>
+void query_adapter::page_collector<T>::fail(std::exception_ptr ptr)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    if (_done)
+        return;
+        
+    _done = true;
+    abort(ptr);
+}
+
+template <typename T>
+void query_adapter::page_collector<T>::finish(std::unique_ptr<result> res)
+{
+    _completion(ready(std::move(res)));
+}
+
+template <typename T>
+void query_adapter::page_collector<T>::abort(std::exception_ptr ptr)
+{
+    _completion(failed(ptr));
+}
+
+/* A query of a batch which asked for the streams of some channels */
+class query_adapter::channel_request {
+public:
+    channel_request(const std::vector<std::string> &channels, 
+                    completion done);
+    virtual ~channel_request() = default;
+    
+    const std::vector<std::string> &channels() const;
+    
+    /* 'res' holds the streams of all channels of the batch */
+    virtual void complete(const result &res) = 0;
+    void fail(std::exception_ptr ptr);
+protected:
+    completion _completion;
+    std::vector<std::string> _channels;
+};
+
+query_adapter::channel_request::channel_request(
+                                const std::vector<std::string> &channels,
+                                completion done)
+    : _completion(std::move(done)),
+      _channels(channels)
+{
+}
+
+const std::vector<std::string> &
+query_adapter::channel_request::channels() const
+{
+    return _channels;
+}
+
+void query_adapter::channel_request::fail(std::exception_ptr ptr)
+{
+    _completion(failed(ptr));
+}
+
+template <typename T>
+class query_adapter::typed_channel_request : public channel_request {
+public:
+    typed_channel_request(const std::vector<std::string> &channels, 
+                          completion done);
+    
+    virtual void complete(const result &res) override;
+};
+
+template <typename T>
+query_adapter::typed_channel_request<T>::typed_channel_request(
+                                const std::vector<std::string> &channels,
+                                completion done)
+    : channel_request(channels, std::move(done))
+{
+}
+
+template <typename T>
+void query_adapter::typed_channel_request<T>::complete(const result &res)
+{
+    auto streams = dynamic_cast<const streams_result *>(&res);
+    if (!streams) {
+        _completion(ready(std::make_unique<error_result>(res.error())));
+        return;
+    }
+    
+    auto selection = std::make_unique<T>();
+    selection->select(*streams, _channels);
+    
+    _completion(ready(std::move(selection)));
+}
+
+/* 
+ * Fetches the streams of all channels of a batch at once and hands
+ * each query of the batch the streams it asked for.
+ */
+class query_adapter::channel_batch : public page_collector<streams_result> {
+public:
+    channel_batch(std::size_t pages, channel_request_vector requests);
+protected:
+    virtual void finish(std::unique_ptr<result> res) override;
+    virtual void abort(std::exception_ptr ptr) override;
+private:
+    channel_request_vector _requests;
+};
+
+query_adapter::channel_batch::channel_batch(std::size_t pages, 
+                                            channel_request_vector requests)
+    : page_collector<streams_result>(pages, completion()),
+      _requests(std::move(requests))
+{
+}
+
+void query_adapter::channel_batch::finish(std::unique_ptr<result> res)
+{
+    for (auto &x : _requests)
+        x->complete(*res);
+}
+
+void query_adapter::channel_batch::abort(std::exception_ptr ptr)
+{
+    for (auto &x : _requests)
+        x->fail(ptr);
+}
+
+/* 
+ * Decodes the response into a result while it is downloaded. The result
+ * is handed to the collector once the last piece was received. If the 
+ * raw JSON is requested, the response is just collected.
+ */
+template <typename T>
+class query_adapter::result_handler : public url_client::handler {
+public:
+    result_handler(std::shared_ptr<page_collector<T>> collector, 
+                   std::size_t page,
+                   bool json);
+    result_handler(const result_handler &other) = delete;
+    
+    virtual bool streaming() const override;
+    virtual void write(const char *data, std::size_t size) override;
+    
+    virtual void response(std::string &&str) override;
+    virtual void error(std::exception_ptr ptr) override;
+    
+    result_handler &operator=(const result_handler &other) = delete;
+private:
+    std::shared_ptr<page_collector<T>> _collector;
+    std::size_t _page;
+    std::unique_ptr<T> _result;
+    json_parser _parser;
+    bool _json;
+};
+
+template <typename T>
+query_adapter::result_handler<T>::result_handler(
+    std::shared_ptr<page_collector<T>> collector, 
+    std::size_t page, 
+    bool json)
+    : _collector(std::move(collector)),
+      _page(page),
+      _result(std::make_unique<T>()),
+      _parser(*_result),
+      _json(json)
+{
+}
+
+template <typename T>
+bool query_adapter::result_handler<T>::streaming() const
+{
+    return true;
+}
+
+template <typename T>
+void query_adapter::result_handler<T>::write(const char *data, 
+                                             std::size_t size)
+{
+    /* Errors abort the transfer and are reported with error() */
+    if (_json) {
+        _result->append_json(data, size);
+        return;
+    }
+    
+    run_stats::timer timer(run_stats::STAGE_PARSE);
+    
+    _parser.parse(data, size);
+}
+
+template <typename T>
+void query_adapter::result_handler<T>::response(std::string &&str)
+{
+    (void) str;
+    
+    try {
+        run_stats::timer timer(run_stats::STAGE_PARSE);
+        
+        /* The raw JSON may still be an error message */
+        if (_json)
+            _result->decode_json_error();
+        else
+            _parser.finish();
+    } catch (...) {
+        _collector->fail(std::current_exception());
+        return;
+    }
+    
+    _collector->complete(_page, std::move(_result));
+}
 
+template <typename T>
+void query_adapter::result_handler<T>::error(std::exception_ptr ptr)
+{
+    _collector->fail(ptr);
+}
 
 query_adapter::query_adapter(const std::string &client_id)
     : query_adapter(client_id.c_str())
@@ -27,107 +364,391 @@ query_adapter::query_adapter(const std::string &client_id)
 }
 
 query_adapter::query_adapter(const char *client_id)
-    : _json_reader(),
-      _query(client_id)
+    : _query(client_id),
+      _batch_mutex(),
+      _channel_requests(),
+      _batch_depth(0),
+      _json(false)
+{
+}
+
+query_adapter::~query_adapter()
 {
 }
 
-std::unique_ptr<result> 
+query_adapter::result_future
 query_adapter::bookmarks(const std::vector<std::string> &channels)
 {
-    auto str = _query.streams(nullptr, &channels);
-    
-    return handle_response<bookmarks_result>(str);
+    return with_future([&](completion done) {
+        bookmarks(channels, std::move(done));
+    });
+}
+
+query_adapter::result_future query_adapter::channels(const std::string &name)
+{
+    return with_future([&](completion done) {
+        channels(name, std::move(done));
+    });
+}
+
+query_adapter::result_future 
+query_adapter::featured_streams(unsigned int limit)
+{
+    return with_future([&](completion done) {
+        featured_streams(limit, std::move(done));
+    });
+}
+
+query_adapter::result_future 
+query_adapter::search_channels(const std::string &query, unsigned int limit)
+{
+    return with_future([&](completion done) {
+        search_channels(query, limit, std::move(done));
+    });
+}
+
+query_adapter::result_future 
+query_adapter::search_games(const std::string &query, bool live)
+{
+    return with_future([&](completion done) {
+        search_games(query, live, std::move(done));
+    });
+}
+
+query_adapter::result_future 
+query_adapter::search_streams(const std::string &query, unsigned int limit)
+{
+    return with_future([&](completion done) {
+        search_streams(query, limit, std::move(done));
+    });
+}
+
+query_adapter::result_future 
+query_adapter::streams(const std::string &game, unsigned int limit)
+{
+    return with_future([&](completion done) {
+        streams(game, limit, std::move(done));
+    });
+}
+
+query_adapter::result_future 
+query_adapter::streams(const std::vector<std::string> &channels)
+{
+    return with_future([&](completion done) {
+        streams(channels, std::move(done));
+    });
+}
+
+query_adapter::result_future query_adapter::top_games(unsigned int limit)
+{
+    return with_future([&](completion done) {
+        top_games(limit, std::move(done));
+    });
+}
+
+query_adapter::result_future query_adapter::users(const std::string &name)
+{
+    return with_future([&](completion done) {
+        users(name, std::move(done));
+    });
+}
+
+void query_adapter::bookmarks(const std::vector<std::string> &channels, 
+                              completion done)
+{
+    channel_streams<bookmarks_result>(channels, std::move(done));
 }
 
-std::unique_ptr<result> query_adapter::channels(const std::string &name)
+void query_adapter::channels(const std::string &name, completion done)
 {
-    auto str = _query.channels(name);
+    auto collector = 
+        std::make_shared<page_collector<channels_result>>(1, std::move(done));
+        
+    _query.channels(make_handler(collector, 0), name);
+}
+
+void query_adapter::featured_streams(unsigned int limit, completion done)
+{
+    typedef page_collector<featured_streams_result> collector_type;
     
-    return handle_response<channels_result>(str);
+    auto pages = page_count(limit);
+    auto collector = std::make_shared<collector_type>(pages, std::move(done));
+    
+    for (unsigned int i = 0; i < pages; ++i) {
+        auto offset = i * PAGE_SIZE;
+        auto size = std::min(limit - offset, PAGE_SIZE);
+        
+        _query.featured_streams(make_handler(collector, i), size, offset);
+    }
 }
 
-std::unique_ptr<result> query_adapter::featured_streams(unsigned int limit)
+void query_adapter::search_channels(const std::string &query, 
+                                    unsigned int limit,
+                                    completion done)
 {
-    auto str = _query.featured_streams(limit);
+    typedef page_collector<search_channels_result> collector_type;
     
-    return handle_response<featured_streams_result>(str);
+    auto pages = page_count(limit);
+    auto collector = std::make_shared<collector_type>(pages, std::move(done));
+    
+    for (unsigned int i = 0; i < pages; ++i) {
+        auto offset = i * PAGE_SIZE;
+        auto size = std::min(limit - offset, PAGE_SIZE);
+        
+        auto handler = make_handler(collector, i);
+        _query.search_channels(std::move(handler), query, size, offset);
+    }
 }
 
-std::unique_ptr<result> query_adapter::search_channels(const std::string &query, 
-                                                       unsigned int limit)
+void query_adapter::search_games(const std::string &query, 
+                                 bool live, 
+                                 completion done)
 {
-    auto str = _query.search_channels(query, limit);
+    typedef page_collector<search_games_result> collector_type;
+    
+    auto collector = std::make_shared<collector_type>(1, std::move(done));
     
-    return handle_response<search_channels_result>(str);
+    _query.search_games(make_handler(collector, 0), query, &live);
 }
 
-std::unique_ptr<result> query_adapter::search_games(const std::string &query, 
-                                                    bool live)
+void query_adapter::search_streams(const std::string &query, 
+                                   unsigned int limit,
+                                   completion done)
 {
-    auto str = _query.search_games(query, &live);
+    typedef page_collector<search_streams_result> collector_type;
     
-    return handle_response<search_games_result>(str);
+    auto pages = page_count(limit);
+    auto collector = std::make_shared<collector_type>(pages, std::move(done));
+    
+    for (unsigned int i = 0; i < pages; ++i) {
+        auto offset = i * PAGE_SIZE;
+        auto size = std::min(limit - offset, PAGE_SIZE);
+        
+        auto handler = make_handler(collector, i);
+        _query.search_streams(std::move(handler), query, size, offset);
+    }
 }
 
-std::unique_ptr<result> query_adapter::search_streams(const std::string &query, 
-                                                      unsigned int limit)
+void query_adapter::streams(const std::string &game, 
+                            unsigned int limit, 
+                            completion done)
 {
-    auto str = _query.search_streams(query, limit);
+    typedef page_collector<streams_result> collector_type;
+    
+    auto pages = page_count(limit);
+    auto collector = std::make_shared<collector_type>(pages, std::move(done));
     
-    return handle_response<search_streams_result>(str);
+    for (unsigned int i = 0; i < pages; ++i) {
+        auto offset = i * PAGE_SIZE;
+        auto size = std::min(limit - offset, PAGE_SIZE);
+        
+        auto handler = make_handler(collector, i);
+        _query.streams(std::move(handler), &game, nullptr, size, offset);
+    }
 }
 
-std::unique_ptr<result> query_adapter::streams(const std::string &game, 
-                                               unsigned int limit)
+void query_adapter::streams(const std::vector<std::string> &channels, 
+                            completion done)
 {
-    auto str = _query.streams(&game, nullptr, limit);
+    channel_streams<streams_result>(channels, std::move(done));
+}
+
+void query_adapter::top_games(unsigned int limit, completion done)
+{
+    typedef page_collector<top_games_result> collector_type;
+    
+    auto pages = page_count(limit);
+    auto collector = std::make_shared<collector_type>(pages, std::move(done));
     
-    return handle_response<streams_result>(str);
+    for (unsigned int i = 0; i < pages; ++i) {
+        auto offset = i * PAGE_SIZE;
+        auto size = std::min(limit - offset, PAGE_SIZE);
+        
+        _query.top_games(make_handler(collector, i), size, offset);
+    }
 }
 
-std::unique_ptr<result> 
-query_adapter::streams(const std::vector<std::string> &channels)
+void query_adapter::users(const std::string &name, completion done)
 {
-    auto str = _query.streams(nullptr, &channels);
+    auto collector = 
+        std::make_shared<page_collector<users_result>>(1, std::move(done));
     
-    return handle_response<streams_result>(str);
+    _query.users(make_handler(collector, 0), name);
 }
 
-std::unique_ptr<result> query_adapter::top_games(unsigned int limit)
+void query_adapter::begin_batch()
 {
-    auto str = _query.top_games(limit);
+    std::lock_guard<std::mutex> lock(_batch_mutex);
     
-    return handle_response<top_games_result>(str);
+    ++_batch_depth;
 }
 
-std::unique_ptr<result> query_adapter::users(const std::string &name)
+void query_adapter::end_batch()
 {
-    auto str = _query.users(name);
+    auto requests = channel_request_vector();
+    
+    {
+        std::lock_guard<std::mutex> lock(_batch_mutex);
+        
+        if (_batch_depth > 0)
+            --_batch_depth;
+            
+        if (_batch_depth > 0 || _channel_requests.empty())
+            return;
+            
+        std::swap(requests, _channel_requests);
+    }
+    
+    /* Every channel is only looked up once */
+    auto channels = std::vector<std::string>();
+    auto names = std::unordered_set<std::string>();
+    
+    for (const auto &x : requests) {
+        for (const auto &name : x->channels()) {
+            if (names.insert(name).second)
+                channels.push_back(name);
+        }
+    }
     
-    return handle_response<users_result>(str);
+    if (channels.empty()) {
+        auto res = streams_result();
+        
+        for (auto &x : requests)
+            x->complete(res);
+            
+        return;
+    }
+    
+    auto pages = chunk_count(channels.size());
+    auto batch = std::make_shared<channel_batch>(pages, std::move(requests));
+    
+    fetch_channels<streams_result>(batch, channels);
+}
+
+void query_adapter::set_json(bool val)
+{
+    _json = val;
+}
+
+const url_client::statistics &query_adapter::stats() const
+{
+    return _query.stats();
+}
+
+void query_adapter::set_base_url(const std::string &url)
+{
+    _query.set_base_url(url);
+}
+
+void query_adapter::set_http2(bool val)
+{
+    _query.set_http2(val);
+}
+
+void query_adapter::set_session_cache(const std::string &path, 
+                                      unsigned int dns_ttl)
+{
+    _query.set_session_cache(path, dns_ttl);
+}
+
+void query_adapter::set_response_cache(std::shared_ptr<response_cache> cache)
+{
+    _query.set_response_cache(std::move(cache));
 }
 
+void query_adapter::set_stale_while_revalidate(bool val)
+{
+    _query.set_stale_while_revalidate(val);
+}
+
+void query_adapter::set_rate_limiter(std::shared_ptr<rate_limiter> limiter)
+{
+    _query.set_rate_limiter(std::move(limiter));
+}
+
+void query_adapter::set_cache_ttl(const std::string &endpoint, 
+                                  unsigned int ttl)
+{
+    _query.set_cache_ttl(endpoint, ttl);
+}
 
 template <typename T>
-std::unique_ptr<result> query_adapter::handle_response(const std::string &str)
+query::handler_ptr 
+query_adapter::make_handler(std::shared_ptr<page_collector<T>> collector, 
+                            std::size_t page) const
 {
-    Json::Value val;
+    return std::make_shared<result_handler<T>>(collector, page, _json);
+}
+
+template <typename T>
+void query_adapter::channel_streams(const std::vector<std::string> &channels,
+                                    completion done)
+{
+    {
+        std::lock_guard<std::mutex> lock(_batch_mutex);
+        
+        /* The raw JSON of a merged lookup can not be split up again */
+        if (_batch_depth > 0 && !_json) {
+            auto request = 
+                std::make_unique<typed_channel_request<T>>(channels, 
+                                                           std::move(done));
+                                                           
+            _channel_requests.push_back(std::move(request));
+            return;
+        }
+    }
+    
+    auto pages = chunk_count(channels.size());
+    auto collector = 
+        std::make_shared<page_collector<T>>(pages, std::move(done));
     
-    auto ok = _json_reader.parse(str, val, false);
-    if (!ok)
-        throw std::runtime_error("Json::Reader::parse() failed");
+    fetch_channels(collector, channels);
+}
+
+template <typename T>
+void query_adapter::fetch_channels(std::shared_ptr<page_collector<T>> collector,
+                                   const std::vector<std::string> &channels)
+{
+    auto pages = chunk_count(channels.size());
+    auto begin = channels.begin();
     
-    if (val.isMember("error")) {
-        auto unique = std::make_unique<error_result>();
-        unique->set_json_value(std::move(val));
+    /* 
+     * Long channel lists are split into chunks which are queried
+     * concurrently. The streams of a whole chunk always fit on a page.
+     */
+    for (unsigned int i = 0; i < pages; ++i) {
+        auto size = std::min<std::size_t>(channels.end() - begin, PAGE_SIZE);
+        auto chunk = std::vector<std::string>(begin, begin + size);
+        auto limit = std::max<unsigned int>(size, 1);
         
-        return std::move(unique);
+        begin += size;
+        
+        _query.streams(make_handler(collector, i), nullptr, &chunk, limit);
     }
+}
+
+unsigned int query_adapter::chunk_count(std::size_t channels)
+{
+    /* Unlike a limit, any number of channels can be looked up */
+    auto chunks = (channels + PAGE_SIZE - 1) / PAGE_SIZE;
     
-    auto unique = std::make_unique<T>();
-    unique->set_json_value(std::move(val));
-    
-    return std::move(unique);
+    return std::max<std::size_t>(chunks, 1);
 }
 
+unsigned int query_adapter::page_count(unsigned int limit)
+{
+    const static unsigned int max = MAX_OFFSET + PAGE_SIZE;
+    
+    /* Pages beyond the maximum offset would only come back empty */
+    if (limit > max) {
+        std::string err_msg = "Invalid limit \"";
+        err_msg += std::to_string(limit);
+        err_msg += "\": value must not exceed ";
+        err_msg += std::to_string(max);
+        
+        throw std::invalid_argument(err_msg);
+    }
+    
+    /* A limit of zero is passed on and rejected by the query */
+    return std::max((limit + PAGE_SIZE - 1) / PAGE_SIZE, 1u);
+}
@@ -24,36 +24,143 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <future>
+#include <functional>
 
 #include "query-results.hpp"
 #include "../query/query.hpp"
 
+/*
+ * Runs the queries of tq and decodes their responses into results. All
+ * queries are non-blocking and a query_adapter may be shared by any 
+ * number of threads. Adapters of the same process share their 
+ * connections through url_engine::shared().
+ */
 class query_adapter {
 public:
     typedef std::vector<std::unique_ptr<result>> result_vector;
+    typedef std::future<std::unique_ptr<result>> result_future;
+    typedef std::vector<result_future> future_vector;
+    
+    /* 
+     * Receives the ready future of a query. It is called on the worker
+     * thread of the url_engine, or by the calling thread if a fresh
+     * response was cached, and should not block.
+     */
+    typedef std::function<void(result_future)> completion;
     
     query_adapter(const std::string &client_id);
     query_adapter(const char *client_id);
+    ~query_adapter();
+    
+    /* 
+     * Each query is issued immediately and runs concurrently with
+     * all other pending queries. The returned future becomes ready
+     * as soon as the response was received and parsed.
+     * 
+     * Limits above the maximum page size of the server are split into
+     * multiple pages which are fetched concurrently and merged into 
+     * one result. The server does not page beyond 1000 items, so 
+     * larger limits are rejected.
+     */
+    result_future bookmarks(const std::vector<std::string> &channels);
+    result_future channels(const std::string &name);
+    result_future featured_streams(unsigned int limit);
+    result_future search_channels(const std::string &query, 
+                                  unsigned int limit);
+    result_future search_games(const std::string &query, bool live);
+    result_future search_streams(const std::string &query, 
+                                 unsigned int limit);
+    result_future streams(const std::string &game, unsigned int limit);
+    result_future streams(const std::vector<std::string> &channels);
+    result_future top_games(unsigned int limit);
+    result_future users(const std::string &name);
+    
+    /* 
+     * The same queries, which pass their result to 'done' instead.
+     * Invalid arguments are reported by an exception of the call.
+     */
+    void bookmarks(const std::vector<std::string> &channels, 
+                   completion done);
+    void channels(const std::string &name, completion done);
+    void featured_streams(unsigned int limit, completion done);
+    void search_channels(const std::string &query, 
+                         unsigned int limit, 
+                         completion done);
+    void search_games(const std::string &query, bool live, completion done);
+    void search_streams(const std::string &query, 
+                        unsigned int limit, 
+                        completion done);
+    void streams(const std::string &game, 
+                 unsigned int limit, 
+                 completion done);
+    void streams(const std::vector<std::string> &channels, completion done);
+    void top_games(unsigned int limit, completion done);
+    void users(const std::string &name, completion done);
     
-    std::unique_ptr<result> bookmarks(const std::vector<std::string> &channels);
-    std::unique_ptr<result> channels(const std::string &name);
-    std::unique_ptr<result> featured_streams(unsigned int limit);
-    std::unique_ptr<result> search_channels(const std::string &query, 
-                                            unsigned int limit);
-    std::unique_ptr<result> search_games(const std::string &query, bool live);
-    std::unique_ptr<result> search_streams(const std::string &query, 
-                                           unsigned int limit);
-    std::unique_ptr<result> streams(const std::string &game, 
-                                    unsigned int limit);
-    std::unique_ptr<result> streams(const std::vector<std::string> &channels);
-    std::unique_ptr<result> top_games(unsigned int limit);
-    std::unique_ptr<result> users(const std::string &name);
+    /* 
+     * The streams of the channels asked for by bookmarks() and 
+     * streams() between begin_batch() and end_batch() are looked up
+     * together: each channel is only queried once and the channels 
+     * share as few requests as possible. The lookup is sent by 
+     * end_batch(). Identical requests are always sent only once.
+     *
+     * Batches may be nested, also by different threads: the lookup is
+     * sent as soon as the outermost batch ended.
+     */
+    void begin_batch();
+    void end_batch();
+    
+    /* Keep the raw JSON of the responses instead of decoding them */
+    void set_json(bool val);
+    void set_base_url(const std::string &url);
+    void set_http2(bool val);
+    void set_session_cache(const std::string &path, unsigned int dns_ttl);
+    void set_response_cache(std::shared_ptr<response_cache> cache);
+    void set_stale_while_revalidate(bool val);
+    void set_rate_limiter(std::shared_ptr<rate_limiter> limiter);
+    void set_cache_ttl(const std::string &endpoint, unsigned int ttl);
+    
+    const url_client::statistics &stats() const;
 private:
     template <typename T>
-    std::unique_ptr<result> handle_response(const std::string &str);
+    class page_collector;
+    
+    template <typename T>
+    class result_handler;
+    
+    class channel_request;
+    
+    template <typename T>
+    class typed_channel_request;
+    
+    class channel_batch;
+    
+    typedef std::vector<std::unique_ptr<channel_request>> 
+    channel_request_vector;
+    
+    template <typename T>
+    query::handler_ptr 
+    make_handler(std::shared_ptr<page_collector<T>> collector, 
+                 std::size_t page) const;
+                 
+    template <typename T>
+    void channel_streams(const std::vector<std::string> &channels, 
+                         completion done);
+    
+    template <typename T>
+    void fetch_channels(std::shared_ptr<page_collector<T>> collector,
+                        const std::vector<std::string> &channels);
+                        
+    static unsigned int page_count(unsigned int limit);
+    static unsigned int chunk_count(std::size_t channels);
 
-    Json::Reader _json_reader;
     query _query;
+    std::mutex _batch_mutex;
+    channel_request_vector _channel_requests;
+    unsigned int _batch_depth;
+    bool _json;
 };
 
 #endif
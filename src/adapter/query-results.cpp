@@ -18,16 +18,25 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <utility>
 #include <unordered_map>
+#include <unordered_set>
+
+#include <json/json.h>
 
 #include "query-results.hpp"
+#include "json-builder.hpp"
+#include "table-writer.hpp"
 
-static void trim_string(std::string &str, unsigned int size)
+/* The server reports all channel names in lower case */
+static std::string to_lower(std::string str)
 {
-    if (str.length() > size)
-        str.erase(size);
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    
+    return str;
 }
 
 static void sanitize_time_string(std::string &str)
@@ -42,8 +51,111 @@ static void sanitize_time_string(std::string &str)
         str.erase(at);
 }
 
+static void write_record(record_writer &out, const channel_record &rec)
+{
+    out.begin();
+    out.field("id", rec.id);
+    out.field("name", rec.name);
+    out.field("game", rec.game);
+    out.field("status", rec.status);
+    out.field("url", rec.url);
+    out.field("language", rec.language);
+    out.field("mature", rec.mature);
+    out.field("delay", rec.delay);
+    out.field("created_at", rec.created_at);
+    out.field("updated_at", rec.updated_at);
+    out.end();
+}
+
+static void write_record(record_writer &out, const stream_record &rec)
+{
+    out.begin();
+    out.field("id", rec.id);
+    out.field("name", rec.channel.name);
+    out.field("game", rec.game);
+    out.field("viewers", rec.viewers);
+    out.field("url", rec.channel.url);
+    out.end();
+}
+
+static void write_record(record_writer &out, const game_record &rec)
+{
+    out.begin();
+    out.field("id", rec.id);
+    out.field("name", rec.name);
+    out.field("popularity", rec.popularity);
+    out.field("viewers", rec.viewers);
+    out.field("channels", rec.channels);
+    out.end();
+}
+
+static void write_record(record_writer &out, const user_record &rec)
+{
+    out.begin();
+    out.field("id", rec.id);
+    out.field("name", rec.name);
+    out.field("display_name", rec.display_name);
+    out.field("bio", rec.bio);
+    out.field("created_at", rec.created_at);
+    out.field("updated_at", rec.updated_at);
+    out.end();
+}
+
+static void write_record(record_writer &out, const error_record &rec)
+{
+    out.begin();
+    out.field("error", rec.error);
+    out.field("status", rec.status);
+    out.field("message", rec.message);
+    out.end();
+}
+
+template <typename T>
+static void dump_record_list(std::ostream &out, 
+                             record_format format,
+                             bool header,
+                             const std::vector<T> &vec)
+{
+    table_writer writer(vec.size() * 128 + 128);
+    record_writer records(writer, format);
+    
+    /* The field names are taken from an empty record */
+    if (header) {
+        records.set_header(true);
+        write_record(records, T());
+        records.set_header(false);
+    }
+    
+    for (const auto &x : vec)
+        write_record(records, x);
+        
+    writer.write(out);
+}
+
+template <typename T>
+static void merge_records(std::vector<T> &vec, std::vector<T> &other)
+{
+    auto ids = std::unordered_set<unsigned long long>();
+    for (const auto &x : vec)
+        ids.insert(x.id);
+        
+    /* 
+     * Pages are requested concurrently, so a record may show up on two
+     * pages if the ranking changed in between. Records without an id
+     * are always kept.
+     */
+    for (auto &x : other) {
+        if (x.id == 0 || ids.insert(x.id).second)
+            vec.push_back(std::move(x));
+    }
+    
+    other.clear();
+}
+
 result::result()
-    : _json_value(),
+    : record_decoder(),
+      _json(),
+      _error(),
       _int_len(11),
       _name_len(20),
       _game_len(40),
@@ -83,204 +195,496 @@ void result::set_verbose(bool val)
     _verbose = val;
 }
 
-void result::set_json_value (Json::Value &&val)
+void result::append_json(const char *data, std::size_t size)
 {
-    _json_value = std::move(val);
+    if (_json.empty())
+        _json.emplace_back();
+        
+    _json.back().append(data, size);
 }
 
-void result::dump_json(std::ostream &out) const
+void result::merge(result &other)
 {
-    Json::StyledStreamWriter("    ").write(out, _json_value);
+    /* Each page is a JSON document of its own */
+    for (auto &x : other._json)
+        _json.push_back(std::move(x));
+        
+    other._json.clear();
 }
 
+const error_record &result::error() const
+{
+    return _error;
+}
 
-void result::dump_channel_header(std::ostream &out) const
+void result::decode_json_error()
 {
-    auto name = std::string("Name");
-    auto game = std::string("Game");
-    
-    trim_string(name, _name_len);
-    trim_string(game, _game_len);
+    /* An error_result decodes nothing but the error message */
+    auto probe = error_result(error_record());
     
-    out << "  " << std::setw(_name_len) << std::left << name
-        << "  " << std::setw(_game_len) << std::left << game
-        << "  " << "URL\n" 
-        << std::setfill('-') << std::setw(_name_len + _game_len + 40)
-        << "" << std::setfill(' ') << "\n";
+    for (const auto &x : _json) {
+        json_parser parser(probe);
+        
+        parser.parse(x);
+        parser.finish();
+        
+        if (!probe.error().error.empty()) {
+            _error = probe.error();
+            return;
+        }
+    }
 }
 
-void result::dump_game_header(std::ostream &out) const
+void result::dump_json(std::ostream &out) const
 {
-    auto popularity = std::string ("Popularity");
-    
-    trim_string(popularity, _int_len);
-    
-    out << "  " << std::setw(_int_len) << std::left << popularity
-        << "  " << "Game\n"
-        << std::setfill('-') << std::setw(_int_len + _game_len)
-        << "" << std::setfill(' ') << std::endl;
+    for (const auto &x : _json) {
+        json_builder builder;
+        json_parser parser(builder);
+        
+        parser.parse(x);
+        parser.finish();
+        
+        Json::StyledStreamWriter("    ").write(out, builder.value());
+    }
 }
 
-void result::dump_stream_header(std::ostream &out) const
+void result::dump_raw_json(std::ostream &out) const
 {
-    auto line_len = _int_len + _name_len + _game_len;
-    
-    auto viewers = std::string("Viewers");
-    auto name = std::string("Name");
-    auto game = std::string("Game");
-    
-    trim_string(viewers, _int_len);
-    trim_string(name, _name_len);
-    trim_string(game, _game_len);
-    
-    out << "  " << std::setw(_int_len)  << std::left << viewers
-        << "  " << std::setw(_name_len) << std::left << name
-        << "  " << std::setw(_game_len) << std::left << game
-        << "  " << "URL\n"
-        << std::setfill('-') << std::setw(line_len)
-        << "" << std::setfill(' ') << "\n";
+    for (const auto &x : _json) {
+        out.write(x.data(), x.size());
+        
+        /* Each response ends up on a line of its own */
+        if (x.empty() || x.back() != '\n')
+            out.put('\n');
+    }
 }
 
-void result::dump_top_header(std::ostream &out) const
+void result::value(const std::string &str)
 {
-    auto viewers = std::string("Viewers");
-    auto channels = std::string("Channels");
-    
-    trim_string(viewers, _int_len);
-    trim_string(channels, _int_len);
+    /* Every response may turn out to be an error message */
+    if (depth() == 1) {
+        if (at({ "error" }))
+            _error.error = str;
+        else if (at({ "message" }))
+            _error.message = str;
+        else if (at({ "status" }))
+            _error.status = to_int(str);
+    }
     
-    out << "  " << std::setw(_int_len) << std::left << viewers
-        << "  " << std::setw(_int_len) << std::left << channels
-        << "  " << "Game\n"
-        << std::setfill('-') << std::setw(2 * _int_len + _game_len)
-        << "" << std::setfill(' ') << "\n";
+    decode(str);
 }
 
-void result::dump_channel(std::ostream &out, const Json::Value &val) const
+void result::decode(const std::string &str)
 {
-    auto name       = val["name"].asString();
-    auto game       = val["game"].asString();
-    const auto url  = val["url"].asString();
-    
-    trim_string(name, _name_len);
-    trim_string(game, _game_len);
-    
-    out << "  " << std::setw(_name_len) << std::left << name
-        << "  " << std::setw(_game_len) << std::left << game
-        << "  " << url << "\n";
+    (void) str;
 }
 
-void result::dump_channel_full(std::ostream &out, const Json::Value &val) const
+void result::decode_channel(channel_record &rec, 
+                            std::size_t depth,
+                            const std::string &str) const
 {
-    const auto name     = val["name"].asString();
-    const auto status   = val["status"].asString();
-    const auto id       = val["_id"].asUInt64();
-    const auto url      = val["url"].asString();
-    const auto game     = val["game"].asString();
-    const auto delay    = val["delay"].asInt();
-    const auto mature   = (val["mature"].asBool()) ? "yes" : "no";
-    const auto language = val["language"].asString();
-    auto created_at     = val["created_at"].asString();
-    auto updated_at     = val["updated_at"].asString();
+    if (at({ "_id" }, depth))
+        rec.id = to_uint64(str);
+    else if (at({ "name" }, depth))
+        rec.name = str;
+    else if (at({ "status" }, depth))
+        rec.status = str;
+    else if (at({ "url" }, depth))
+        rec.url = str;
+    else if (at({ "game" }, depth))
+        rec.game = str;
+    else if (at({ "delay" }, depth))
+        rec.delay = to_int(str);
+    else if (at({ "mature" }, depth))
+        rec.mature = to_bool(str);
+    else if (at({ "language" }, depth))
+        rec.language = str;
+    else if (at({ "created_at" }, depth))
+        rec.created_at = str;
+    else if (at({ "updated_at" }, depth))
+        rec.updated_at = str;
+}
+
+void result::decode_stream(stream_record &rec, 
+                           std::size_t depth,
+                           const std::string &str) const
+{
+    if (at({ "_id" }, depth))
+        rec.id = to_uint64(str);
+    else if (at({ "viewers" }, depth))
+        rec.viewers = to_int(str);
+    else if (at({ "game" }, depth))
+        rec.game = str;
+    else if (at({ "channel", "name" }, depth))
+        rec.channel.name = str;
+    else if (at({ "channel", "url" }, depth))
+        rec.channel.url = str;
+}
+
+
+void result::dump_channel_header(table_writer &out) const
+{
+    out.append("  ");
+    out.left("Name", _name_len);
+    out.append("  ");
+    out.left("Game", _game_len);
+    out.append("  URL\n");
+    out.fill('-', _name_len + _game_len + 40);
+    out.append('\n');
+}
+
+void result::dump_game_header(table_writer &out) const
+{
+    out.append("  ");
+    out.left("Popularity", _int_len);
+    out.append("  Game\n");
+    out.fill('-', _int_len + _game_len);
+    out.append('\n');
+}
+
+void result::dump_stream_header(table_writer &out) const
+{
+    out.append("  ");
+    out.left("Viewers", _int_len);
+    out.append("  ");
+    out.left("Name", _name_len);
+    out.append("  ");
+    out.left("Game", _game_len);
+    out.append("  URL\n");
+    out.fill('-', _int_len + _name_len + _game_len);
+    out.append('\n');
+}
+
+void result::dump_top_header(table_writer &out) const
+{
+    out.append("  ");
+    out.left("Viewers", _int_len);
+    out.append("  ");
+    out.left("Channels", _int_len);
+    out.append("  Game\n");
+    out.fill('-', 2 * _int_len + _game_len);
+    out.append('\n');
+}
+
+void result::dump_channel(table_writer &out, const channel_record &rec) const
+{
+    out.append("  ");
+    out.left(rec.name, _name_len);
+    out.append("  ");
+    out.left(rec.game, _game_len);
+    out.append("  ");
+    out.append(rec.url);
+    out.append('\n');
+}
+
+void result::dump_channel_full(table_writer &out, 
+                               const channel_record &rec) const
+{
+    auto created_at = rec.created_at;
+    auto updated_at = rec.updated_at;
     
     sanitize_time_string(created_at);
     sanitize_time_string(updated_at);
     
-    out << "  Channel [ " << name << " ]:"      << "\n"
-        << "      Status     : " << status      << "\n"
-        << "      ID         : " << id          << "\n"
-        << "      Url        : " << url         << "\n"
-        << "      Game       : " << game        << "\n"
-        << "      Delay      : " << delay       << " s\n"
-        << "      Mature     : " << mature      << "\n"
-        << "      Language   : " << language    << "\n"
-        << "      Created at : " << created_at  << "\n"
-        << "      Updated at : " << updated_at  << "\n";
+    out.append("  Channel [ ");
+    out.append(rec.name);
+    out.append(" ]:\n      Status     : ");
+    out.append(rec.status);
+    out.append("\n      ID         : ");
+    out.append(rec.id);
+    out.append("\n      Url        : ");
+    out.append(rec.url);
+    out.append("\n      Game       : ");
+    out.append(rec.game);
+    out.append("\n      Delay      : ");
+    out.append(rec.delay);
+    out.append(" s\n      Mature     : ");
+    out.append((rec.mature) ? "yes" : "no");
+    out.append("\n      Language   : ");
+    out.append(rec.language);
+    out.append("\n      Created at : ");
+    out.append(created_at);
+    out.append("\n      Updated at : ");
+    out.append(updated_at);
+    out.append('\n');
 }
 
 
-void result::dump_stream(std::ostream &out, const Json::Value &val) const
+void result::dump_stream(table_writer &out, const stream_record &rec) const
 {
-    const auto channel = val["channel"];
-    
-    auto name           = channel["name"].asString();
-    const auto url      = channel["url"].asString();
-    const auto viewers  = val["viewers"].asInt();
-    auto game           = val["game"].asString();
-    
-    trim_string(name, _name_len);
-    trim_string(game, _game_len);
-    
-    out << "  " << std::setw(_int_len)  << std::right << viewers
-        << "  " << std::setw(_name_len) << std::left  << name
-        << "  " << std::setw(_game_len) << std::left << game
-        << "  " << url << "\n";
+    out.append("  ");
+    out.right(rec.viewers, _int_len);
+    out.append("  ");
+    out.left(rec.channel.name, _name_len);
+    out.append("  ");
+    out.left(rec.game, _game_len);
+    out.append("  ");
+    out.append(rec.channel.url);
+    out.append('\n');
 }
 
-void result::dump_stream_full(std::ostream &out, const Json::Value &val) const
+void result::dump_stream_full(table_writer &out, 
+                              const stream_record &rec) const
 {
-    const auto chan = val["channel"];
-    
-    const auto name    = chan["name"].asString();
-    const auto url     = chan["url"].asString();
-    const auto viewers = val["viewers"].asInt();
-    const auto id      = val["_id"].asUInt64();
-    const auto game    = val["game"].asString();
-    
-    out << "  Stream [ " << name << " ]:"   << "\n"
-        << "      Url     : " << url        << "\n"
-        << "      Viewers : " << viewers    << "\n"
-        << "      Id      : " << id         << "\n"
-        << "      Game    : " << game       << "\n";
+    out.append("  Stream [ ");
+    out.append(rec.channel.name);
+    out.append(" ]:\n      Url     : ");
+    out.append(rec.channel.url);
+    out.append("\n      Viewers : ");
+    out.append(rec.viewers);
+    out.append("\n      Id      : ");
+    out.append(rec.id);
+    out.append("\n      Game    : ");
+    out.append(rec.game);
+    out.append('\n');
 }
 
-void result::dump_stream_list(std::ostream &out, const Json::Value &val) const
+void result::dump_stream_list(table_writer &out, 
+                              const std::vector<stream_record> &vec) const
 {
     if (_verbose) {
-        for (const auto &x : val["streams"])
+        for (const auto &x : vec)
             dump_stream_full(out, x);
     } else {
         if (_descriptive)
             dump_stream_header(out);
         
-        for (const auto &x : val["streams"])
+        for (const auto &x : vec)
             dump_stream(out, x);
     }
 }
 
 
+error_result::error_result(const error_record &rec)
+    : result()
+{
+    _error = rec;
+}
+
 void error_result::dump(std::ostream &out) const
 {
-    auto msg   = _json_value["message"].asString();
-    auto code  = _json_value["status"].asInt();
-    auto error = _json_value["error"].asString();
+    table_writer writer(256);
     
-    out << "** ERROR: received error message from server: " << error
-        << " / " << code << " - " << msg << std::endl;
+    writer.append("** ERROR: received error message from server: ");
+    writer.append(_error.error);
+    writer.append(" / ");
+    writer.append(_error.status);
+    writer.append(" - ");
+    writer.append(_error.message);
+    writer.append('\n');
+    
+    writer.write(out);
+    out.flush();
+}
+
+void error_result::dump_records(std::ostream &out, 
+                                record_format format) const
+{
+    auto vec = std::vector<error_record>(1, _error);
+    
+    dump_record_list(out, format, _descriptive, vec);
+}
+
+stream_list_result::stream_list_result()
+    : result(),
+      _streams()
+{
+}
+
+void stream_list_result::merge(stream_list_result &other)
+{
+    result::merge(other);
+    merge_records(_streams, other._streams);
+}
+
+void stream_list_result::select(const stream_list_result &all, 
+                                const std::vector<std::string> &channels)
+{
+    auto names = std::unordered_set<std::string>();
+    
+    for (const auto &x : channels)
+        names.insert(to_lower(x));
+        
+    for (const auto &x : all._streams) {
+        if (names.count(to_lower(x.channel.name)) > 0)
+            _streams.push_back(x);
+    }
+}
+
+void stream_list_result::dump_records(std::ostream &out, 
+                                      record_format format) const
+{
+    dump_record_list(out, format, _descriptive, _streams);
+}
+
+void stream_list_result::object()
+{
+    if (at({ "streams", "[]" }))
+        _streams.emplace_back();
+}
+
+void stream_list_result::decode(const std::string &str)
+{
+    if (!_streams.empty() && within({ "streams", "[]" }))
+        decode_stream(_streams.back(), 2, str);
+}
+
+bookmarks_result::bookmarks_result()
+    : stream_list_result(),
+      _channels()
+{
+}
+
+void bookmarks_result::merge(bookmarks_result &other)
+{
+    stream_list_result::merge(other);
+    
+    for (auto &x : other._channels)
+        _channels.push_back(std::move(x));
+        
+    other._channels.clear();
+}
+
+void bookmarks_result::decode(const std::string &str)
+{
+    if (at({ "_links", "self" }))
+        add_channels(str);
+    else
+        stream_list_result::decode(str);
 }
 
 void bookmarks_result::dump(std::ostream &out) const
 {
-    static const std::string begin_str = "channel=";
-    static const std::string sep_str = "%2C";
+    table_writer writer(_channels.size() * 128);
     
     if (_section)
-        std::cout << "[ Bookmarks ]:\n";
+        writer.append("[ Bookmarks ]:\n");
     
-    auto stream_map = std::unordered_map<std::string, const Json::Value *>();
-    for (auto &x : _json_value["streams"]) {
-        const auto name = x["channel"]["name"].asString();
+    auto stream_map = streams_by_name();
+    
+    /* Iterate over all queried streams and print them. */
+    for (const auto &name : _channels) {
+        auto it = stream_map.find(to_lower(name));
         
-        stream_map[name] = &x;
+        if (it != stream_map.end()) {
+            dump_stream_full(writer, *it->second);
+        } else {
+            writer.append("  Stream [ ");
+            writer.append(name);
+            writer.append(" ]: offline\n");
+        }
     }
+    
+    writer.write(out);
+}
 
-    /* 
-     * Iterate over all queried streams and print them.
-     * The queried names are extracted from link 'self'.
-     */
-    auto self = _json_value["_links"]["self"].asString();
+void bookmarks_result::dump_changes(std::ostream &out, 
+                                    live_map &live,
+                                    unsigned int viewer_delta) const
+{
+    table_writer writer;
+    
+    auto stream_map = streams_by_name();
+    
+    for (const auto &name : _channels) {
+        auto it = stream_map.find(to_lower(name));
+        auto prev_it = live.find(name);
+        
+        auto is_live = it != stream_map.end();
+        auto was_live = prev_it != live.end();
+        
+        if (!is_live) {
+            if (was_live) {
+                writer.append("  Stream [ ");
+                writer.append(name);
+                writer.append(" ]: offline\n");
+                live.erase(prev_it);
+            }
+            
+            continue;
+        }
+        
+        const auto &rec = *it->second;
+        
+        if (!was_live) {
+            writer.append("  Stream [ ");
+            writer.append(name);
+            writer.append(" ]: online - ");
+            writer.append(rec.game);
+            writer.append(" - ");
+            writer.append(rec.viewers);
+            writer.append(" viewers\n");
+                
+            live.insert({ name, rec });
+            continue;
+        }
+        
+        auto &prev_rec = prev_it->second;
+        
+        if (rec.game != prev_rec.game) {
+            writer.append("  Stream [ ");
+            writer.append(name);
+            writer.append(" ]: game - ");
+            writer.append(prev_rec.game);
+            writer.append(" -> ");
+            writer.append(rec.game);
+            writer.append('\n');
+        }
+        
+        auto delta = std::abs(rec.viewers - prev_rec.viewers);
+        
+        /* Slowly changing viewers still get reported eventually */
+        if (viewer_delta > 0 && (unsigned int) delta >= viewer_delta) {
+            writer.append("  Stream [ ");
+            writer.append(name);
+            writer.append(" ]: viewers - ");
+            writer.append(prev_rec.viewers);
+            writer.append(" -> ");
+            writer.append(rec.viewers);
+            writer.append('\n');
+                
+            prev_rec.viewers = rec.viewers;
+        }
+        
+        prev_rec.game = rec.game;
+    }
+    
+    writer.write(out);
+}
+
+void bookmarks_result::live_streams(live_map &live) const
+{
+    auto stream_map = streams_by_name();
+    
+    for (const auto &name : _channels) {
+        auto it = stream_map.find(to_lower(name));
+        
+        if (it != stream_map.end())
+            live[name] = *it->second;
+        else
+            live.erase(name);
+    }
+}
 
+const std::vector<std::string> &bookmarks_result::channels() const
+{
+    return _channels;
+}
+
+void bookmarks_result::select(const stream_list_result &all, 
+                              const std::vector<std::string> &channels)
+{
+    stream_list_result::select(all, channels);
     
+    _channels = channels;
+}
+
+void bookmarks_result::add_channels(const std::string &self)
+{
+    static const std::string begin_str = "channel=";
+    static const std::string sep_str = "%2C";
+    
+    /* The queried names are extracted from the 'self' link. */
     auto index = self.find(begin_str);
     if (index == std::string::npos)
         throw std::runtime_error("Invalid response from server\n");
@@ -290,134 +694,342 @@ void bookmarks_result::dump(std::ostream &out) const
     auto end = self.find("&", begin);
     if (end == std::string::npos)
         end = self.size();
-    
+        
     while (begin < end) {
         index = self.find(sep_str, begin);
         if (index == std::string::npos || index > end)
             index = end;
         
-        const auto name = self.substr(begin, index - begin);
+        _channels.push_back(self.substr(begin, index - begin));
         begin = index + sep_str.size();
-        
-        auto it = stream_map.find(name);
-        
-        if (it != stream_map.end())
-            dump_stream_full(out, *it->second);
-        else
-            std::cout << "  Stream [ " << name << " ]: offline\n";
     }
 }
 
+bookmarks_result::stream_map bookmarks_result::streams_by_name() const
+{
+    auto map = stream_map();
+    
+    for (auto &x : _streams)
+        map[to_lower(x.channel.name)] = &x;
+        
+    return map;
+}
+
+channels_result::channels_result()
+    : result(),
+      _channel()
+{
+}
+
+void channels_result::decode(const std::string &str)
+{
+    decode_channel(_channel, 0, str);
+}
+
 void channels_result::dump(std::ostream &out) const
 {
-    dump_channel_full(out, _json_value);
+    table_writer writer(512);
+    
+    dump_channel_full(writer, _channel);
+    
+    writer.write(out);
+}
+
+void channels_result::dump_records(std::ostream &out, 
+                                   record_format format) const
+{
+    auto vec = std::vector<channel_record>(1, _channel);
+    
+    dump_record_list(out, format, _descriptive, vec);
+}
+
+featured_streams_result::featured_streams_result()
+    : result(),
+      _streams()
+{
+}
+
+void featured_streams_result::merge(featured_streams_result &other)
+{
+    result::merge(other);
+    merge_records(_streams, other._streams);
+}
+
+void featured_streams_result::object()
+{
+    if (at({ "featured", "[]" }))
+        _streams.emplace_back();
+}
+
+void featured_streams_result::decode(const std::string &str)
+{
+    if (!_streams.empty() && within({ "featured", "[]", "stream" }))
+        decode_stream(_streams.back(), 3, str);
 }
 
 void featured_streams_result::dump(std::ostream &out) const
 {
+    table_writer writer(_streams.size() * 128);
+    
     if (_section)
-        out << "[ Featured ]:\n";
+        writer.append("[ Featured ]:\n");
     
-    auto featured_list = _json_value["featured"];
+    dump_stream_list(writer, _streams);
     
-    if (_verbose) {
-        for (const auto &x : featured_list)
-            dump_stream_full(out, x["stream"]);
-        
-    } else {
-        if (_descriptive)
-            dump_stream_header(out);
-        
-        for (const auto &x : featured_list)
-            dump_stream(out, x["stream"]);
-    }
+    writer.write(out);
+}
+
+void featured_streams_result::dump_records(std::ostream &out, 
+                                           record_format format) const
+{
+    dump_record_list(out, format, _descriptive, _streams);
+}
+
+search_channels_result::search_channels_result()
+    : result(),
+      _channels()
+{
+}
+
+void search_channels_result::merge(search_channels_result &other)
+{
+    result::merge(other);
+    merge_records(_channels, other._channels);
+}
+
+void search_channels_result::object()
+{
+    if (at({ "channels", "[]" }))
+        _channels.emplace_back();
+}
+
+void search_channels_result::decode(const std::string &str)
+{
+    if (!_channels.empty() && within({ "channels", "[]" }))
+        decode_channel(_channels.back(), 2, str);
 }
 
 void search_channels_result::dump(std::ostream &out) const
 {
+    table_writer writer(_channels.size() * 128);
+    
     if (_section)
-        out << "[ Search Channels ]:\n";
+        writer.append("[ Search Channels ]:\n");
     
     if (_verbose) {
-        for (const auto &x : _json_value["channels"])
-            dump_channel_full(out, x);
+        for (const auto &x : _channels)
+            dump_channel_full(writer, x);
     } else {
         if (_descriptive)
-            dump_channel_header(out);
+            dump_channel_header(writer);
         
-        for (const auto &x : _json_value["channels"])
-            dump_channel(out, x);
+        for (const auto &x : _channels)
+            dump_channel(writer, x);
     }
+    
+    writer.write(out);
+}
+
+void search_channels_result::dump_records(std::ostream &out, 
+                                          record_format format) const
+{
+    dump_record_list(out, format, _descriptive, _channels);
+}
+
+search_games_result::search_games_result()
+    : result(),
+      _games()
+{
+}
+
+void search_games_result::object()
+{
+    if (at({ "games", "[]" }))
+        _games.emplace_back();
+}
+
+void search_games_result::decode(const std::string &str)
+{
+    if (_games.empty())
+        return;
+        
+    if (at({ "games", "[]", "name" }))
+        _games.back().name = str;
+    else if (at({ "games", "[]", "popularity" }))
+        _games.back().popularity = to_int(str);
 }
 
 void search_games_result::dump(std::ostream &out) const
 {
+    table_writer writer(_games.size() * 64);
+    
     if (_section)
-       out << "[ Search Games ]:\n";
+        writer.append("[ Search Games ]:\n");
     
     if (_descriptive)
-        dump_game_header(out);
+        dump_game_header(writer);
     
-    for (auto &x : _json_value["games"]) {
-        auto name = x["name"].asString();
-        auto pop  = x["popularity"].asInt();
-        
-        out << "  " << std::setw(_int_len) << std::right << pop
-            << "  " << name << "\n";
+    for (auto &x : _games) {
+        writer.append("  ");
+        writer.right(x.popularity, _int_len);
+        writer.append("  ");
+        writer.append(x.name);
+        writer.append('\n');
     }
+    
+    writer.write(out);
+}
+
+void search_games_result::dump_records(std::ostream &out, 
+                                       record_format format) const
+{
+    dump_record_list(out, format, _descriptive, _games);
 }
 
 void search_streams_result::dump(std::ostream &out) const
 {
+    table_writer writer(_streams.size() * 128);
+    
     if (_section)
-        out << "[ Search Streams ]:\n";
+        writer.append("[ Search Streams ]:\n");
+        
+    dump_stream_list(writer, _streams);
     
-    dump_stream_list(out, _json_value);
+    writer.write(out);
 }
 
 void streams_result::dump(std::ostream &out) const
 {
+    table_writer writer(_streams.size() * 128);
+    
     if (_section)
-        out << "[ Streams ]:\n";
+        writer.append("[ Streams ]:\n");
+    
+    dump_stream_list(writer, _streams);
     
-    dump_stream_list(out, _json_value);
+    writer.write(out);
+}
+
+top_games_result::top_games_result()
+    : result(),
+      _games()
+{
+}
+
+void top_games_result::merge(top_games_result &other)
+{
+    result::merge(other);
+    merge_records(_games, other._games);
+}
+
+void top_games_result::object()
+{
+    if (at({ "top", "[]" }))
+        _games.emplace_back();
+}
+
+void top_games_result::decode(const std::string &str)
+{
+    if (_games.empty())
+        return;
+        
+    if (at({ "top", "[]", "game", "_id" }))
+        _games.back().id = to_uint64(str);
+    else if (at({ "top", "[]", "viewers" }))
+        _games.back().viewers = to_int(str);
+    else if (at({ "top", "[]", "channels" }))
+        _games.back().channels = to_int(str);
+    else if (at({ "top", "[]", "game", "name" }))
+        _games.back().name = str;
+    else if (at({ "top", "[]", "game", "popularity" }))
+        _games.back().popularity = to_int(str);
 }
 
 void top_games_result::dump(std::ostream &out) const
 {
+    table_writer writer(_games.size() * 64);
+    
     if (_section)
-        out << "[ Top ]:\n";
+        writer.append("[ Top ]:\n");
     
     if (_descriptive)
-        dump_top_header(out);
+        dump_top_header(writer);
     
-    for (auto &x : _json_value["top"]) {
-        const auto viewers = x["viewers"].asInt();
-        const auto channels = x["channels"].asInt();
-        const auto game = x["game"]["name"].asString();
-        
-        out << "  " << std::setw(_int_len) << std::right << viewers 
-            << "  " << std::setw(_int_len) << std::right << channels 
-            << "  " << game  << std::endl;
+    for (auto &x : _games) {
+        writer.append("  ");
+        writer.right(x.viewers, _int_len);
+        writer.append("  ");
+        writer.right(x.channels, _int_len);
+        writer.append("  ");
+        writer.append(x.name);
+        writer.append('\n');
     }
+    
+    writer.write(out);
+}
+
+void top_games_result::dump_records(std::ostream &out, 
+                                    record_format format) const
+{
+    dump_record_list(out, format, _descriptive, _games);
+}
+
+users_result::users_result()
+    : result(),
+      _user()
+{
+}
+
+void users_result::decode(const std::string &str)
+{
+    if (depth() != 1)
+        return;
+        
+    if (at({ "_id" }))
+        _user.id = to_uint64(str);
+    else if (at({ "name" }))
+        _user.name = str;
+    else if (at({ "display_name" }))
+        _user.display_name = str;
+    else if (at({ "bio" }))
+        _user.bio = str;
+    else if (at({ "created_at" }))
+        _user.created_at = str;
+    else if (at({ "updated_at" }))
+        _user.updated_at = str;
 }
 
 void users_result::dump(std::ostream &out) const
 {
-    const auto display_name = _json_value["display_name"].asString();
-    const auto name         = _json_value["name"].asString();
-    const auto bio          = _json_value["bio"].asString();
-    const auto id           = _json_value["_id"].asUInt64();
-    auto created_at         = _json_value["created_at"].asString();
-    auto updated_at         = _json_value["updated_at"].asString();
+    table_writer writer(512);
+    
+    auto created_at = _user.created_at;
+    auto updated_at = _user.updated_at;
     
     sanitize_time_string(created_at);
     sanitize_time_string(updated_at);
     
-    out << "  User [ " << display_name << " ]:\n"
-        << "      Name       : " << name << "\n"
-        << "      ID         : " << id << "\n"
-        << "      Biography  : " << bio << "\n"
-        << "      Created at : " << created_at << "\n"
-        << "      Updated at : " << updated_at << "\n";
+    writer.append("  User [ ");
+    writer.append(_user.display_name);
+    writer.append(" ]:\n      Name       : ");
+    writer.append(_user.name);
+    writer.append("\n      ID         : ");
+    writer.append(_user.id);
+    writer.append("\n      Biography  : ");
+    writer.append(_user.bio);
+    writer.append("\n      Created at : ");
+    writer.append(created_at);
+    writer.append("\n      Updated at : ");
+    writer.append(updated_at);
+    writer.append('\n');
+    
+    writer.write(out);
+}
+
+void users_result::dump_records(std::ostream &out, 
+                                record_format format) const
+{
+    auto vec = std::vector<user_record>(1, _user);
+    
+    dump_record_list(out, format, _descriptive, vec);
 }
@@ -23,15 +23,40 @@
 
 #include <iostream>
 #include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
 
-#include <json/json.h>
+#include "records.hpp"
+#include "record-decoder.hpp"
+#include "record-writer.hpp"
 
-class result {
+/*
+ * A result decodes the response it is fed by a json_parser into typed
+ * records and prints them. Unless the raw JSON is requested, nothing
+ * else of the response is kept.
+ */
+class result : public record_decoder {
 public:
     result();
     virtual ~result() = default;
     
-    void set_json_value(Json::Value &&val);
+    void append_json(const char *data, std::size_t size);
+    
+    /* 
+     * Appends the records of another page of the same query. Records
+     * which are already part of this result are skipped.
+     */
+    void merge(result &other);
+    
+    /* The error message of the server, if there was one */
+    const error_record &error() const;
+    
+    /* 
+     * Picks the error message out of the kept raw JSON, which is not
+     * decoded otherwise.
+     */
+    void decode_json_error();
     
     void set_integer_length(unsigned int len);
     void set_name_length(unsigned int len);
@@ -42,21 +67,43 @@ public:
     void set_verbose(bool val);
     
     void dump_json(std::ostream &out = std::cout) const;
+    
+    /* Prints the responses byte for byte as they were received */
+    void dump_raw_json(std::ostream &out = std::cout) const;
     virtual void dump(std::ostream &out = std::cout) const = 0;
+    
+    /* 
+     * Prints one line per record in a machine readable 'format'. If
+     * descriptive, TSV and CSV start with a line of field names.
+     */
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const = 0;
 protected:
-    void dump_channel_header(std::ostream &out) const;
-    void dump_game_header(std::ostream &out) const;
-    void dump_stream_header(std::ostream &out) const;
-    void dump_top_header(std::ostream &out) const;
+    virtual void decode(const std::string &str);
+    
+    void decode_channel(channel_record &rec, 
+                        std::size_t depth,
+                        const std::string &str) const;
+    void decode_stream(stream_record &rec, 
+                       std::size_t depth,
+                       const std::string &str) const;
+                       
+    void dump_channel_header(table_writer &out) const;
+    void dump_game_header(table_writer &out) const;
+    void dump_stream_header(table_writer &out) const;
+    void dump_top_header(table_writer &out) const;
     
-    void dump_channel(std::ostream &out, const Json::Value &val) const;
-    void dump_channel_full(std::ostream &out, const Json::Value &val) const;
-    void dump_stream(std::ostream &out, const Json::Value &val) const;
-    void dump_stream_full(std::ostream &out, const Json::Value &val) const;
+    void dump_channel(table_writer &out, const channel_record &rec) const;
+    void dump_channel_full(table_writer &out, 
+                           const channel_record &rec) const;
+    void dump_stream(table_writer &out, const stream_record &rec) const;
+    void dump_stream_full(table_writer &out, const stream_record &rec) const;
     
-    void dump_stream_list(std::ostream &out, const Json::Value &val) const;
+    void dump_stream_list(table_writer &out, 
+                          const std::vector<stream_record> &vec) const;
     
-    Json::Value _json_value;
+    std::vector<std::string> _json;
+    error_record _error;
     
     unsigned int _int_len;
     unsigned int _name_len;
@@ -65,56 +112,174 @@ protected:
     bool _descriptive;
     bool _section;
     bool _verbose;
+private:
+    virtual void value(const std::string &str) override;
 };
 
 class error_result : public result {
 public:
+    explicit error_result(const error_record &rec);
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+};
+
+/* Common base of all results with a "streams" list */
+class stream_list_result : public result {
+public:
+    void merge(stream_list_result &other);
+    
+    /* Takes the streams of 'channels' from the streams of 'all' */
+    void select(const stream_list_result &all, 
+                const std::vector<std::string> &channels);
+                
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+protected:
+    stream_list_result();
+    
+    virtual void object() override;
+    virtual void decode(const std::string &str) override;
+    
+    std::vector<stream_record> _streams;
 };
 
-class bookmarks_result : public result {
+class bookmarks_result : public stream_list_result {
 public:
+    bookmarks_result();
+    
+    void merge(bookmarks_result &other);
+    void select(const stream_list_result &all, 
+                const std::vector<std::string> &channels);
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    
+    /* Maps the name of each stream known to be live to its record */
+    typedef std::unordered_map<std::string, stream_record> live_map;
+    
+    /* 
+     * Prints one line for each queried stream which went live or 
+     * offline compared with 'live', changed its game or whose number
+     * of viewers changed by at least 'viewer_delta'. A 'viewer_delta'
+     * of zero ignores the viewers. Afterwards, 'live' is up to date.
+     */
+    void dump_changes(std::ostream &out, 
+                      live_map &live,
+                      unsigned int viewer_delta) const;
+                      
+    /* Updates 'live' for the queried channels without printing */
+    void live_streams(live_map &live) const;
+    
+    const std::vector<std::string> &channels() const;
+protected:
+    virtual void decode(const std::string &str) override;
+private:
+    typedef std::unordered_map<std::string, const stream_record *> stream_map;
+    
+    void add_channels(const std::string &self);
+    stream_map streams_by_name() const;
+    
+    /* The queried channels in order, including the offline ones */
+    std::vector<std::string> _channels;
 };
 
 class channels_result : public result {
 public:
+    channels_result();
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+protected:
+    virtual void decode(const std::string &str) override;
+private:
+    channel_record _channel;
 };
 
 class featured_streams_result : public result {
 public:
+    featured_streams_result();
+    
+    void merge(featured_streams_result &other);
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+protected:
+    virtual void object() override;
+    virtual void decode(const std::string &str) override;
+private:
+    std::vector<stream_record> _streams;
 };
 
 class search_channels_result : public result {
 public:
+    search_channels_result();
+    
+    void merge(search_channels_result &other);
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+protected:
+    virtual void object() override;
+    virtual void decode(const std::string &str) override;
+private:
+    std::vector<channel_record> _channels;
 };
 
 class search_games_result : public result {
 public:
+    search_games_result();
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+protected:
+    virtual void object() override;
+    virtual void decode(const std::string &str) override;
+private:
+    std::vector<game_record> _games;
 };
 
-class search_streams_result : public result {
+class search_streams_result : public stream_list_result {
 public:
     virtual void dump(std::ostream &out = std::cout) const override;
 };
 
-class streams_result : public result {
+class streams_result : public stream_list_result {
 public:
     virtual void dump(std::ostream &out = std::cout) const override;
 };
 
 class top_games_result : public result {
 public:
+    top_games_result();
+    
+    void merge(top_games_result &other);
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+protected:
+    virtual void object() override;
+    virtual void decode(const std::string &str) override;
+private:
+    std::vector<game_record> _games;
 };
 
 class users_result : public result {
 public:
+    users_result();
+    
     virtual void dump(std::ostream &out = std::cout) const override;
+    virtual void dump_records(std::ostream &out, 
+                              record_format format) const override;
+protected:
+    virtual void decode(const std::string &str) override;
+private:
+    user_record _user;
 };
 
 #endif /* _QUERY_RESULTS_HPP_ */
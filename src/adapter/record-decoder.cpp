@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+
+#include "record-decoder.hpp"
+
+record_decoder::record_decoder()
+    : _path(),
+      _depth(0)
+{
+    _path.reserve(8);
+}
+
+void record_decoder::begin_object()
+{
+    object();
+    push("");
+}
+
+void record_decoder::end_object()
+{
+    --_depth;
+}
+
+void record_decoder::begin_array()
+{
+    push("[]");
+}
+
+void record_decoder::end_array()
+{
+    --_depth;
+}
+
+void record_decoder::key(const std::string &str)
+{
+    /* Reuses the memory of the previous key */
+    _path[_depth - 1] = str;
+}
+
+void record_decoder::string(const std::string &str)
+{
+    value(str);
+}
+
+void record_decoder::number(const std::string &str)
+{
+    value(str);
+}
+
+void record_decoder::boolean(bool val)
+{
+    static const std::string true_str = "true";
+    static const std::string false_str = "false";
+    
+    value((val) ? true_str : false_str);
+}
+
+void record_decoder::null()
+{
+    static const std::string null_str;
+    
+    value(null_str);
+}
+
+void record_decoder::object()
+{
+}
+
+bool record_decoder::at(std::initializer_list<const char *> path,
+                        std::size_t depth) const
+{
+    if (_depth != depth + path.size())
+        return false;
+        
+    for (auto x : path) {
+        if (_path[depth++] != x)
+            return false;
+    }
+    
+    return true;
+}
+
+bool record_decoder::within(std::initializer_list<const char *> path) const
+{
+    if (_depth <= path.size())
+        return false;
+        
+    std::size_t i = 0;
+    
+    for (auto x : path) {
+        if (_path[i++] != x)
+            return false;
+    }
+    
+    return true;
+}
+
+std::size_t record_decoder::depth() const
+{
+    return _depth;
+}
+
+int record_decoder::to_int(const std::string &str)
+{
+    return (int) std::strtol(str.c_str(), nullptr, 10);
+}
+
+unsigned long long record_decoder::to_uint64(const std::string &str)
+{
+    return std::strtoull(str.c_str(), nullptr, 10);
+}
+
+bool record_decoder::to_bool(const std::string &str)
+{
+    return str == "true";
+}
+
+void record_decoder::push(const char *key)
+{
+    if (_path.size() == _depth)
+        _path.emplace_back();
+        
+    _path[_depth++] = key;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RECORD_DECODER_HPP_
+#define _RECORD_DECODER_HPP_
+
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+#include "json-parser.hpp"
+
+/*
+ * Keeps track of the position within the document while it is parsed,
+ * so subclasses only have to pick the values they are interested in.
+ * Everything else is dropped as soon as it was parsed.
+ *
+ * A position is given by the keys leading to it. Elements of an 
+ * array are matched by the key "[]".
+ */
+class record_decoder : public json_parser::handler {
+public:
+    record_decoder();
+    virtual ~record_decoder() = default;
+    
+    virtual void begin_object() override;
+    virtual void end_object() override;
+    virtual void begin_array() override;
+    virtual void end_array() override;
+    
+    virtual void key(const std::string &str) override;
+    virtual void string(const std::string &str) override;
+    virtual void number(const std::string &str) override;
+    virtual void boolean(bool val) override;
+    virtual void null() override;
+protected:
+    /* An object begins at the current position */
+    virtual void object();
+    
+    /* 
+     * A string, number or boolean at the current position in its 
+     * textual representation. Null is passed as an empty string.
+     */
+    virtual void value(const std::string &str) = 0;
+    
+    /* True if the current position, from 'depth' on, is 'path' */
+    bool at(std::initializer_list<const char *> path, 
+            std::size_t depth = 0) const;
+            
+    /* True if the current position lies below 'path' */
+    bool within(std::initializer_list<const char *> path) const;
+    
+    std::size_t depth() const;
+    
+    static int to_int(const std::string &str);
+    static unsigned long long to_uint64(const std::string &str);
+    static bool to_bool(const std::string &str);
+private:
+    void push(const char *key);
+    
+    std::vector<std::string> _path;
+    std::size_t _depth;
+};
+
+#endif /* _RECORD_DECODER_HPP_ */
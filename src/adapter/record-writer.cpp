@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+
+#include "record-writer.hpp"
+
+record_writer::record_writer(table_writer &out, record_format format)
+    : _out(out),
+      _format(format),
+      _header(false),
+      _first(true)
+{
+    if (_format == record_format::table)
+        throw std::invalid_argument("Tables are not written as records.");
+}
+
+record_format record_writer::parse_format(const std::string &str)
+{
+    if (str == "table")
+        return record_format::table;
+    else if (str == "ndjson")
+        return record_format::ndjson;
+    else if (str == "tsv")
+        return record_format::tsv;
+    else if (str == "csv")
+        return record_format::csv;
+        
+    throw std::invalid_argument("Unknown output format \"" + str + "\".");
+}
+
+void record_writer::set_header(bool val)
+{
+    _header = val;
+}
+
+void record_writer::begin()
+{
+    if (_header && _format == record_format::ndjson)
+        return;
+        
+    if (_format == record_format::ndjson)
+        _out.append('{');
+        
+    _first = true;
+}
+
+void record_writer::end()
+{
+    if (_header && _format == record_format::ndjson)
+        return;
+        
+    if (_format == record_format::ndjson)
+        _out.append('}');
+        
+    _out.append('\n');
+}
+
+void record_writer::field(const char *key, const std::string &val)
+{
+    this->key(key);
+    
+    if (_header)
+        return;
+        
+    switch (_format) {
+    case record_format::ndjson:
+        _out.append('"');
+        escape_json(val);
+        _out.append('"');
+        break;
+    case record_format::tsv:
+        escape_tsv(val);
+        break;
+    case record_format::csv:
+        escape_csv(val);
+        break;
+    default:
+        break;
+    }
+}
+
+void record_writer::field(const char *key, int val)
+{
+    this->key(key);
+    
+    if (!_header)
+        _out.append(val);
+}
+
+void record_writer::field(const char *key, unsigned long long val)
+{
+    this->key(key);
+    
+    if (!_header)
+        _out.append(val);
+}
+
+void record_writer::field(const char *key, bool val)
+{
+    this->key(key);
+    
+    if (!_header)
+        _out.append((val) ? "true" : "false");
+}
+
+void record_writer::key(const char *key)
+{
+    if (_header && _format == record_format::ndjson)
+        return;
+        
+    if (!_first)
+        _out.append((_format == record_format::tsv) ? '\t' : ',');
+        
+    _first = false;
+    
+    if (_header) {
+        _out.append(key);
+    } else if (_format == record_format::ndjson) {
+        _out.append('"');
+        _out.append(key);
+        _out.append("\":");
+    }
+}
+
+void record_writer::escape_json(const std::string &str)
+{
+    static const char digits[] = "0123456789abcdef";
+    
+    for (auto c : str) {
+        switch (c) {
+        case '"':
+            _out.append("\\\"");
+            break;
+        case '\\':
+            _out.append("\\\\");
+            break;
+        case '\n':
+            _out.append("\\n");
+            break;
+        case '\r':
+            _out.append("\\r");
+            break;
+        case '\t':
+            _out.append("\\t");
+            break;
+        default:
+            if ((unsigned char) c < 0x20) {
+                _out.append("\\u00");
+                _out.append(digits[(c >> 4) & 0x0f]);
+                _out.append(digits[c & 0x0f]);
+            } else {
+                _out.append(c);
+            }
+            break;
+        }
+    }
+}
+
+void record_writer::escape_tsv(const std::string &str)
+{
+    /* Tabs and line breaks would split the value */
+    for (auto c : str) {
+        switch (c) {
+        case '\\':
+            _out.append("\\\\");
+            break;
+        case '\n':
+            _out.append("\\n");
+            break;
+        case '\r':
+            _out.append("\\r");
+            break;
+        case '\t':
+            _out.append("\\t");
+            break;
+        default:
+            _out.append(c);
+            break;
+        }
+    }
+}
+
+void record_writer::escape_csv(const std::string &str)
+{
+    auto quote = str.find_first_of(",\"\r\n") != std::string::npos;
+    
+    if (!quote) {
+        _out.append(str);
+        return;
+    }
+    
+    /* RFC 4180: quoted values escape a quote by doubling it */
+    _out.append('"');
+    
+    for (auto c : str) {
+        if (c == '"')
+            _out.append('"');
+            
+        _out.append(c);
+    }
+    
+    _out.append('"');
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RECORD_WRITER_HPP_
+#define _RECORD_WRITER_HPP_
+
+#include <string>
+
+#include "table-writer.hpp"
+
+enum class record_format {
+    table,
+    ndjson,
+    tsv,
+    csv,
+};
+
+/*
+ * Writes one line per record into a table_writer. Depending on the
+ * format a record becomes a compact JSON object, tab separated or 
+ * comma separated values. Strings are escaped on the fly while they 
+ * are copied into the buffer.
+ *
+ * In header mode the names of the fields are written instead of their
+ * values, which yields the header line of a TSV or CSV table. JSON 
+ * objects carry their field names anyway, so nothing is written.
+ */
+class record_writer {
+public:
+    record_writer(table_writer &out, record_format format);
+    record_writer(const record_writer &other) = delete;
+    
+    static record_format parse_format(const std::string &str);
+    
+    void set_header(bool val);
+    
+    void begin();
+    void end();
+    
+    void field(const char *key, const std::string &val);
+    void field(const char *key, int val);
+    void field(const char *key, unsigned long long val);
+    void field(const char *key, bool val);
+    
+    record_writer &operator=(const record_writer &other) = delete;
+private:
+    void key(const char *key);
+    
+    void escape_json(const std::string &str);
+    void escape_tsv(const std::string &str);
+    void escape_csv(const std::string &str);
+    
+    table_writer &_out;
+    record_format _format;
+    bool _header;
+    bool _first;
+};
+
+#endif /* _RECORD_WRITER_HPP_ */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "records.hpp"
+
+channel_record::channel_record()
+    : id(0),
+      name(),
+      status(),
+      url(),
+      game(),
+      language(),
+      created_at(),
+      updated_at(),
+      delay(0),
+      mature(false)
+{
+}
+
+stream_record::stream_record()
+    : id(0),
+      viewers(0),
+      game(),
+      channel()
+{
+}
+
+game_record::game_record()
+    : id(0),
+      name(),
+      popularity(0),
+      viewers(0),
+      channels(0)
+{
+}
+
+user_record::user_record()
+    : id(0),
+      name(),
+      display_name(),
+      bio(),
+      created_at(),
+      updated_at()
+{
+}
+
+error_record::error_record()
+    : error(),
+      message(),
+      status(0)
+{
+}
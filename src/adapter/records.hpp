@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RECORDS_HPP_
+#define _RECORDS_HPP_
+
+#include <string>
+
+/* 
+ * The parts of the server responses which are actually printed.
+ * Everything else is skipped while decoding.
+ */
+
+struct channel_record {
+    channel_record();
+    
+    unsigned long long id;
+    std::string name;
+    std::string status;
+    std::string url;
+    std::string game;
+    std::string language;
+    std::string created_at;
+    std::string updated_at;
+    int delay;
+    bool mature;
+};
+
+struct stream_record {
+    stream_record();
+    
+    unsigned long long id;
+    int viewers;
+    std::string game;
+    channel_record channel;
+};
+
+struct game_record {
+    game_record();
+    
+    unsigned long long id;
+    std::string name;
+    int popularity;
+    int viewers;
+    int channels;
+};
+
+struct user_record {
+    user_record();
+    
+    unsigned long long id;
+    std::string name;
+    std::string display_name;
+    std::string bio;
+    std::string created_at;
+    std::string updated_at;
+};
+
+struct error_record {
+    error_record();
+    
+    std::string error;
+    std::string message;
+    int status;
+};
+
+#endif /* _RECORDS_HPP_ */
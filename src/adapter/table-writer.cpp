@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "table-writer.hpp"
+
+table_writer::table_writer(std::size_t capacity)
+    : _buffer(),
+      _digits()
+{
+    _buffer.reserve(capacity);
+}
+
+void table_writer::left(const std::string &str, unsigned int width)
+{
+    if (str.size() >= width) {
+        _buffer.append(str, 0, width);
+        return;
+    }
+    
+    _buffer.append(str);
+    _buffer.append(width - str.size(), ' ');
+}
+
+void table_writer::right(long long val, unsigned int width)
+{
+    auto negative = val < 0;
+    auto abs = negative ? 0ULL - (unsigned long long) val : val;
+    
+    auto len = format(abs, negative);
+    
+    /* Like std::setw(), numbers are never cut */
+    if (len < width)
+        _buffer.append(width - len, ' ');
+        
+    _buffer.append(_digits + sizeof(_digits) - len, len);
+}
+
+void table_writer::append(const std::string &str)
+{
+    _buffer.append(str);
+}
+
+void table_writer::append(const char *str)
+{
+    _buffer.append(str, std::strlen(str));
+}
+
+void table_writer::append(char c)
+{
+    _buffer.push_back(c);
+}
+
+void table_writer::append(int val)
+{
+    append((long long) val);
+}
+
+void table_writer::append(long long val)
+{
+    right(val, 0);
+}
+
+void table_writer::append(unsigned long long val)
+{
+    auto len = format(val, false);
+    
+    _buffer.append(_digits + sizeof(_digits) - len, len);
+}
+
+void table_writer::fill(char c, std::size_t count)
+{
+    _buffer.append(count, c);
+}
+
+void table_writer::write(std::ostream &out)
+{
+    out.write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+}
+
+std::size_t table_writer::format(unsigned long long val, bool negative)
+{
+    /* The digits are written backwards from the end of the buffer */
+    auto end = _digits + sizeof(_digits);
+    auto p = end;
+    
+    do {
+        *--p = '0' + val % 10;
+        val /= 10;
+    } while (val > 0);
+    
+    if (negative)
+        *--p = '-';
+       
+    return end - p;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TABLE_WRITER_HPP_
+#define _TABLE_WRITER_HPP_
+
+#include <ostream>
+#include <string>
+
+/*
+ * Formats the output of a result into a single buffer which is then 
+ * written with one call. Columns have a fixed width: text which is
+ * longer is cut, shorter text and numbers are padded with spaces.
+ */
+class table_writer {
+public:
+    explicit table_writer(std::size_t capacity = 4096);
+    
+    void left(const std::string &str, unsigned int width);
+    void right(long long val, unsigned int width);
+    
+    void append(const std::string &str);
+    void append(const char *str);
+    void append(char c);
+    void append(int val);
+    void append(long long val);
+    void append(unsigned long long val);
+    
+    void fill(char c, std::size_t count);
+    
+    void write(std::ostream &out);
+private:
+    std::size_t format(unsigned long long val, bool negative);
+    
+    std::string _buffer;
+    
+    /* Enough for the digits and the sign of any 64 bit integer */
+    char _digits[24];
+};
+
+#endif /* _TABLE_WRITER_HPP_ */
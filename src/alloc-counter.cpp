@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <new>
+#include <cstdlib>
+
+#include "run-stats.hpp"
+
+/* 
+ * Counting is all the replaced operators do, they are cheap enough to
+ * be used in every run. They are part of the tq executable only: libtq
+ * leaves the allocator of the program it is linked to alone.
+ */
+void *operator new(std::size_t size)
+{
+    run_stats::count_allocation(size);
+    
+    auto ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+        
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t size) noexcept
+{
+    (void) size;
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t size) noexcept
+{
+    (void) size;
+    std::free(ptr);
+}
@@ -21,10 +21,14 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <cctype>
 
 #include <boost/program_options.hpp>
 
 #include "config.hpp"
+#include "run-stats.hpp"
 
 namespace opt = boost::program_options;
 
@@ -40,11 +44,24 @@ config::config(const std::string &path)
       _int_len(11),
       _name_len(20),
       _game_len(40),
+      _base_url("https://api.twitch.tv/kraken/"),
+      _http2(false),
+      _session_cache(false),
+      _dns_ttl(300),
+      _rate_limit(0),
+      _rate_burst(100),
+      _response_cache(false),
+      _persistent_cache(false),
+      _stale_while_revalidate(false),
+      _cache_ttls(),
+      _cache_ttl_map(),
       _opener(),
       _args(),
       _shortcuts(),
       _shortcut_map()
 {
+    run_stats::timer timer(run_stats::STAGE_CONFIG);
+    
     _shortcuts.reserve(128);
     _shortcut_map.reserve(128);
     
@@ -61,10 +78,29 @@ config::config(const std::string &path)
         ("printer.integer-length", opt::value(&_int_len))
         ("printer.name-length",    opt::value(&_name_len))
         ("printer.game-length",    opt::value(&_game_len))
+        ("network.base-url",       opt::value(&_base_url))
+        ("network.http2",          opt::value(&_http2))
+        ("network.session-cache",  opt::value(&_session_cache))
+        ("network.dns-ttl",        opt::value(&_dns_ttl))
+        ("network.rate-limit",     opt::value(&_rate_limit))
+        ("network.rate-burst",     opt::value(&_rate_burst))
+        ("cache.enabled",          opt::value(&_response_cache))
+        ("cache.persistent",       opt::value(&_persistent_cache))
+        ("cache.stale-while-revalidate", 
+                                   opt::value(&_stale_while_revalidate))
         ("stream.opener",          opt::value(&_opener))
         ("stream.arg",             opt::value(&_args))
         ("game-shortcuts.arg",     opt::value(&_shortcuts));
     
+    const char *endpoints[] = {
+        "channels", "featured", "search", "streams", "top", "users"
+    };
+    
+    for (auto x : endpoints) {
+        auto name = std::string("cache.") + x;
+        desc.add_options()(name.c_str(), opt::value(&_cache_ttls[x]));
+    }
+    
     try {
         opt::variables_map conf_var_map;
         std::ifstream i_file(path);
@@ -98,6 +134,22 @@ config::config(const std::string &path)
                    << "integer-length = " << _int_len     << "\n"
                    << "name-length    = " << _name_len    << "\n"
                    << "game-length    = " << _game_len    << "\n\n"
+                   << "[network]\n"
+                   << "base-url      = " << _base_url       << "\n"
+                   << "http2         = " << _http2          << "\n"
+                   << "session-cache = " << _session_cache  << "\n"
+                   << "dns-ttl       = " << _dns_ttl        << "\n"
+                   << "rate-limit    = " << _rate_limit     << "\n"
+                   << "rate-burst    = " << _rate_burst     << "\n\n"
+                   << "[cache]\n"
+                   << "enabled                = " << _response_cache   << "\n"
+                   << "persistent             = " << _persistent_cache << "\n"
+                   << "stale-while-revalidate = " << _stale_while_revalidate
+                   << "\n"
+                   << "#top      = 60s\n"
+                   << "#featured = 5m\n"
+                   << "#users    = 1d\n"
+                   << "#channels = 1h\n\n"
                    << "[stream]\n"
                    << "#opener = /usr/bin/livestreamer\n"
                    << "#arg = --default-stream=best\n"
@@ -223,6 +275,11 @@ config::config(const std::string &path)
             }
             
             _shortcuts.clear();
+            
+            for (const auto &x : _cache_ttls) {
+                if (!x.second.empty())
+                    _cache_ttl_map[x.first] = parse_duration(x.second);
+            }
         }
         
     } catch (std::exception &e) {
@@ -281,6 +338,57 @@ unsigned int config::game_length() const
     return _game_len;
 }
 
+const std::string &config::base_url() const
+{
+    return _base_url;
+}
+
+bool config::http2() const
+{
+    return _http2;
+}
+
+bool config::session_cache() const
+{
+    return _session_cache;
+}
+
+unsigned int config::dns_ttl() const
+{
+    return _dns_ttl;
+}
+
+unsigned int config::rate_limit() const
+{
+    return _rate_limit;
+}
+
+unsigned int config::rate_burst() const
+{
+    return _rate_burst;
+}
+
+bool config::response_cache() const
+{
+    return _response_cache;
+}
+
+bool config::persistent_cache() const
+{
+    return _persistent_cache;
+}
+
+bool config::stale_while_revalidate() const
+{
+    return _stale_while_revalidate;
+}
+
+const std::unordered_map<std::string, unsigned int> &
+config::cache_ttl_map() const
+{
+    return _cache_ttl_map;
+}
+
 const std::string &config::stream_opener() const
 {
     return _opener;
@@ -296,3 +404,47 @@ config::game_shortcut_map() const
 {
     return _shortcut_map;
 }
+
+unsigned int config::parse_duration(const std::string &str)
+{
+    std::size_t pos = 0;
+    unsigned long val = 0;
+    
+    /* std::stoul() also skips spaces and accepts a sign */
+    if (str.empty() || !std::isdigit((unsigned char) str[0]))
+        throw std::invalid_argument("Invalid duration \"" + str + "\"");
+        
+    try {
+        val = std::stoul(str, &pos);
+    } catch (std::exception &e) {
+        pos = 0;
+    }
+    
+    auto unit = str.substr(pos);
+    
+    if (pos == 0 || unit.size() > 1) 
+        throw std::invalid_argument("Invalid duration \"" + str + "\"");
+        
+    unsigned long factor = 1;
+    
+    switch (unit.empty() ? 's' : unit[0]) {
+    case 'd':
+        factor *= 24;
+        /* fall through */
+    case 'h':
+        factor *= 60;
+        /* fall through */
+    case 'm':
+        factor *= 60;
+        /* fall through */
+    case 's':
+        break;
+    default:
+        throw std::invalid_argument("Invalid duration \"" + str + "\"");
+    }
+    
+    if (val > std::numeric_limits<unsigned int>::max() / factor)
+        throw std::out_of_range("Duration \"" + str + "\" is too long");
+        
+    return val * factor;
+}
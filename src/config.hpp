@@ -44,11 +44,31 @@ public:
     unsigned int name_length() const;
     unsigned int game_length() const;
     
+    const std::string &base_url() const;
+    bool http2() const;
+    bool session_cache() const;
+    unsigned int dns_ttl() const;
+    
+    /* Requests per minute and how many of them may be sent at once */
+    unsigned int rate_limit() const;
+    unsigned int rate_burst() const;
+    
+    bool response_cache() const;
+    bool persistent_cache() const;
+    bool stale_while_revalidate() const;
+    
+    /* Maps an endpoint to the time its cached responses are used */
+    const std::unordered_map<std::string, unsigned int> &
+    cache_ttl_map() const;
+    
     const std::string &stream_opener() const;
     const std::vector<std::string> &stream_opener_args() const;
     
     const std::unordered_map<std::string, std::string> &
     game_shortcut_map() const;
+    
+    /* Accepts durations like "90", "90s", "15m", "2h" or "1d" */
+    static unsigned int parse_duration(const std::string &str);
 private:
     std::string _client_id;
     
@@ -64,6 +84,20 @@ private:
     unsigned int _name_len;
     unsigned int _game_len;
     
+    std::string _base_url;
+    bool _http2;
+    bool _session_cache;
+    unsigned int _dns_ttl;
+    unsigned int _rate_limit;
+    unsigned int _rate_burst;
+    
+    bool _response_cache;
+    bool _persistent_cache;
+    bool _stale_while_revalidate;
+    
+    std::unordered_map<std::string, std::string> _cache_ttls;
+    std::unordered_map<std::string, unsigned int> _cache_ttl_map;
+    
     std::string _opener;
     std::vector<std::string> _args;
     std::vector<std::string> _shortcuts;
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "daemon-client.hpp"
+#include "daemon-protocol.hpp"
+
+daemon_client::daemon_client(const std::string &path)
+    : _socket(),
+      _connected(false)
+{
+    _connected = _socket.connect(path);
+    
+    /* Anybody else could fake the output or steal the client id */
+    if (_connected && _socket.peer_uid() != geteuid())
+        _connected = false;
+}
+
+bool daemon_client::connected() const
+{
+    return _connected;
+}
+
+int daemon_client::run(const std::vector<std::string> &args, 
+                       std::ostream &out, 
+                       std::ostream &err)
+{
+    _socket.write_u32(args.size());
+    
+    for (const auto &x : args)
+        _socket.write_string(x);
+        
+    bool received = false;
+    
+    try {
+        while (true) {
+            auto type = _socket.read_u32();
+            
+            switch (type) {
+            case FRAME_EXIT:
+                return (int) _socket.read_u32();
+            case FRAME_OUT:
+                out << _socket.read_string(MAX_FRAME_SIZE) << std::flush;
+                break;
+            case FRAME_ERR:
+                err << _socket.read_string(MAX_FRAME_SIZE) << std::flush;
+                break;
+            default:
+                throw std::runtime_error("Received invalid frame type.");
+            }
+            
+            received = true;
+        }
+    } catch (std::exception &e) {
+        /* Running the command line again would repeat the output */
+        if (!received)
+            throw;
+            
+        err << "Exception: " << e.what() << std::endl;
+        
+        return EXIT_FAILURE;
+    }
+}
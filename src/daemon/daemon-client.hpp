@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DAEMON_CLIENT_HPP_
+#define _DAEMON_CLIENT_HPP_
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "unix-socket.hpp"
+
+/*
+ * Forwards a command line to a running daemon_server and writes
+ * the received output to the passed streams as it arrives. A server run by another
+ * user is never connected to.
+ */
+class daemon_client {
+public:
+    /* Returned by the server if the command has to run in the client */
+    static const int run_locally = -1;
+    
+    explicit daemon_client(const std::string &path);
+    
+    bool connected() const;
+    
+    int run(const std::vector<std::string> &args, 
+            std::ostream &out, 
+            std::ostream &err);
+private:
+    unix_socket _socket;
+    bool _connected;
+};
+
+#endif /* _DAEMON_CLIENT_HPP_ */
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DAEMON_PROTOCOL_HPP_
+#define _DAEMON_PROTOCOL_HPP_
+
+#include <cstdint>
+
+/*
+ * A client sends the number of arguments followed by the arguments.
+ * The server answers with the output of the run in any number of 
+ * frames as soon as it is produced. Each frame starts with its type: 
+ * output frames carry a string of at most MAX_FRAME_SIZE bytes, the 
+ * final exit frame carries the exit status.
+ */
+enum daemon_frame : std::uint32_t {
+    FRAME_EXIT,
+    FRAME_OUT,
+    FRAME_ERR,
+};
+
+#define MAX_FRAME_SIZE 16384u
+
+#endif /* _DAEMON_PROTOCOL_HPP_ */
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <streambuf>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <csignal>
+
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "daemon-server.hpp"
+#include "daemon-protocol.hpp"
+
+/* Limits of a command line received from a client */
+#define MAX_ARGC     4096u
+#define MAX_ARG_SIZE 65536u
+
+/* Further clients are turned away and run their command lines locally */
+#define MAX_CLIENTS 64u
+
+/* Clients send their command line at once, but may read slowly */
+#define REQUEST_TIMEOUT 5u
+#define OUTPUT_TIMEOUT  30u
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int signum)
+{
+    (void) signum;
+    
+    stop_requested = 1;
+}
+
+/* Sends everything written to it in frames of 'type' */
+class frame_buffer : public std::streambuf {
+public:
+    frame_buffer(unix_socket &socket, daemon_frame type);
+    frame_buffer(const frame_buffer &other) = delete;
+    
+    frame_buffer &operator=(const frame_buffer &other) = delete;
+protected:
+    virtual int_type overflow(int_type c) override;
+    virtual int sync() override;
+private:
+    bool send();
+    
+    unix_socket &_socket;
+    daemon_frame _type;
+    char _buffer[MAX_FRAME_SIZE];
+};
+
+frame_buffer::frame_buffer(unix_socket &socket, daemon_frame type)
+    : std::streambuf(),
+      _socket(socket),
+      _type(type),
+      _buffer()
+{
+    setp(_buffer, _buffer + sizeof(_buffer));
+}
+
+frame_buffer::int_type frame_buffer::overflow(int_type c)
+{
+    if (!send())
+        return traits_type::eof();
+        
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    
+    return traits_type::not_eof(c);
+}
+
+int frame_buffer::sync()
+{
+    return send() ? 0 : -1;
+}
+
+bool frame_buffer::send()
+{
+    if (pptr() == pbase())
+        return true;
+        
+    /* The client went away: the output of the run is lost anyway */
+    try {
+        _socket.write_u32(_type);
+        _socket.write_string(std::string(pbase(), pptr()));
+    } catch (std::exception &) {
+        return false;
+    }
+    
+    setp(_buffer, _buffer + sizeof(_buffer));
+    
+    return true;
+}
+
+daemon_server::daemon_server(const std::string &path, handler func)
+    : _path(path),
+      _handler(std::move(func)),
+      _socket(),
+      _mutex(),
+      _idle_cond(),
+      _clients(0)
+{
+    /* A leftover socket of a crashed daemon can be removed safely */
+    if (unix_socket().connect(_path)) {
+        std::string err_msg = "A tq daemon is already listening on \"";
+        err_msg += _path;
+        err_msg += "\".";
+        
+        throw std::runtime_error(err_msg);
+    }
+    
+    unlink(_path.c_str());
+    
+    /* Only the owner is allowed to talk to the daemon */
+    auto mask = umask(S_IRWXG | S_IRWXO);
+    
+    try {
+        _socket.listen(_path);
+    } catch (...) {
+        umask(mask);
+        throw;
+    }
+    
+    umask(mask);
+    
+    struct sigaction action;
+    
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &handle_signal;
+    
+    /* No SA_RESTART: a blocking accept() has to return on a signal */
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+daemon_server::~daemon_server()
+{
+    unlink(_path.c_str());
+}
+
+void daemon_server::run()
+{
+    while (!stop_requested) {
+        auto socket = _socket.accept();
+        if (!socket.valid())
+            continue;
+            
+        try {
+            if (socket.peer_uid() != geteuid()) {
+                std::cerr << "** Warning: rejected connection of user " 
+                          << socket.peer_uid() << "\n";
+                continue;
+            }
+            
+            spawn(std::move(socket));
+        } catch (std::exception &e) {
+            std::cerr << "** Warning: failed to serve request - " 
+                      << e.what() << "\n";
+        }
+    }
+    
+    /* The threads use the handler and this object */
+    std::unique_lock<std::mutex> lock(_mutex);
+    
+    _idle_cond.wait(lock, [this]() { return _clients == 0; });
+}
+
+void daemon_server::spawn(unix_socket socket)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        
+        if (_clients >= MAX_CLIENTS)
+            return;
+            
+        ++_clients;
+    }
+    
+    auto func = [this](unix_socket client) {
+        try {
+            client.set_timeout(REQUEST_TIMEOUT);
+            serve(client);
+        } catch (std::exception &e) {
+            std::cerr << "** Warning: failed to serve request - " 
+                      << e.what() << "\n";
+        }
+        
+        std::lock_guard<std::mutex> lock(_mutex);
+        
+        if (--_clients == 0)
+            _idle_cond.notify_all();
+    };
+    
+    /* Signals have to interrupt accept() in the thread of run() */
+    sigset_t set, old_set;
+    
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, &old_set);
+    
+    try {
+        std::thread(func, std::move(socket)).detach();
+    } catch (...) {
+        pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+        
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_clients;
+        throw;
+    }
+    
+    pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+}
+
+void daemon_server::serve(unix_socket &socket)
+{
+    std::vector<std::string> args;
+    
+    auto argc = socket.read_u32();
+    
+    /* There is always the name of the program */
+    if (argc == 0 || argc > MAX_ARGC) {
+        std::string err_msg = "Invalid number of arguments ";
+        err_msg += std::to_string(argc);
+        err_msg += ".";
+        
+        throw std::runtime_error(err_msg);
+    }
+    
+    args.reserve(argc);
+    
+    for (std::uint32_t i = 0; i < argc; ++i)
+        args.push_back(socket.read_string(MAX_ARG_SIZE));
+        
+    socket.set_timeout(OUTPUT_TIMEOUT);
+    
+    frame_buffer out_buffer(socket, FRAME_OUT);
+    frame_buffer err_buffer(socket, FRAME_ERR);
+    std::ostream out(&out_buffer);
+    std::ostream err(&err_buffer);
+    
+    auto status = _handler(args, out, err);
+    
+    out.flush();
+    err.flush();
+    
+    socket.write_u32(FRAME_EXIT);
+    socket.write_u32(status);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DAEMON_SERVER_HPP_
+#define _DAEMON_SERVER_HPP_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "unix-socket.hpp"
+
+/*
+ * Accepts command lines from daemon_client instances on a unix domain
+ * socket, runs them with 'handler' and streams back the produced output.
+ * Each connection is served by a thread of its own, so 'handler' may be
+ * called concurrently. Requests are served until SIGINT or SIGTERM
+ * is received. Connections of other users are rejected.
+ */
+class daemon_server {
+public:
+    typedef std::function<int(const std::vector<std::string> &,
+                              std::ostream &,
+                              std::ostream &)> handler;
+                              
+    daemon_server(const std::string &path, handler func);
+    daemon_server(const daemon_server &other) = delete;
+    ~daemon_server();
+    
+    void run();
+    
+    daemon_server &operator=(const daemon_server &other) = delete;
+private:
+    void spawn(unix_socket socket);
+    void serve(unix_socket &socket);
+    
+    std::string _path;
+    handler _handler;
+    unix_socket _socket;
+    
+    std::mutex _mutex;
+    std::condition_variable _idle_cond;
+    unsigned int _clients;
+};
+
+#endif /* _DAEMON_SERVER_HPP_ */
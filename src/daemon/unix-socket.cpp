@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <utility>
+#include <cerrno>
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "unix-socket.hpp"
+
+static void throw_errno(const std::string &msg)
+{
+    char buffer[64];
+    
+    std::string err_msg = msg;
+    err_msg += " - ";
+    err_msg += strerror_r(errno, buffer, sizeof(buffer));
+    
+    throw std::runtime_error(err_msg);
+}
+
+static struct sockaddr_un make_address(const std::string &path)
+{
+    struct sockaddr_un addr;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("Socket path \"" + path + "\" too long.");
+        
+    path.copy(addr.sun_path, path.size());
+    
+    return addr;
+}
+
+unix_socket::unix_socket()
+    : _fd(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0))
+{
+    if (_fd < 0)
+        throw_errno("socket() failed");
+}
+
+unix_socket::unix_socket(int fd)
+    : _fd(fd)
+{
+}
+
+unix_socket::unix_socket(unix_socket &&other)
+    : _fd(other._fd)
+{
+    other._fd = -1;
+}
+
+unix_socket::~unix_socket()
+{
+    if (_fd >= 0)
+        close(_fd);
+}
+
+bool unix_socket::connect(const std::string &path)
+{
+    auto addr = make_address(path);
+    
+    int err = ::connect(_fd, (struct sockaddr *) &addr, sizeof(addr));
+    if (err < 0) {
+        /* Nobody is listening on 'path' */
+        if (errno == ENOENT || errno == ECONNREFUSED)
+            return false;
+            
+        throw_errno("connect() to \"" + path + "\" failed");
+    }
+    
+    return true;
+}
+
+void unix_socket::listen(const std::string &path)
+{
+    auto addr = make_address(path);
+    
+    int err = bind(_fd, (struct sockaddr *) &addr, sizeof(addr));
+    if (err < 0)
+        throw_errno("bind() to \"" + path + "\" failed");
+        
+    err = ::listen(_fd, 16);
+    if (err < 0)
+        throw_errno("listen() on \"" + path + "\" failed");
+}
+
+unix_socket unix_socket::accept()
+{
+    int fd = accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    
+    /* Interrupted by a signal: let the caller decide what to do */
+    if (fd < 0 && errno != EINTR)
+        throw_errno("accept() failed");
+        
+    return unix_socket(fd);
+}
+
+bool unix_socket::valid() const
+{
+    return _fd >= 0;
+}
+
+uid_t unix_socket::peer_uid() const
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    
+    int err = getsockopt(_fd, SOL_SOCKET, SO_PEERCRED, &cred, &len);
+    if (err < 0)
+        throw_errno("getsockopt() failed");
+        
+    return cred.uid;
+}
+
+void unix_socket::set_timeout(unsigned int seconds)
+{
+    struct timeval tv;
+    
+    tv.tv_sec = seconds;
+    tv.tv_usec = 0;
+    
+    int err = setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (err < 0)
+        throw_errno("setsockopt() failed");
+        
+    err = setsockopt(_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (err < 0)
+        throw_errno("setsockopt() failed");
+}
+
+bool unix_socket::private_directory(const std::string &path)
+{
+    int err = mkdir(path.c_str(), S_IRWXU);
+    if (err < 0 && errno != EEXIST)
+        return false;
+        
+    struct stat st;
+    
+    /* Do not follow a symbolic link planted by somebody else */
+    err = lstat(path.c_str(), &st);
+    if (err < 0)
+        return false;
+        
+    return S_ISDIR(st.st_mode) && st.st_uid == geteuid() 
+           && (st.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+void unix_socket::write_u32(std::uint32_t val)
+{
+    write(&val, sizeof(val));
+}
+
+void unix_socket::write_string(const std::string &str)
+{
+    write_u32(str.size());
+    write(str.data(), str.size());
+}
+
+std::uint32_t unix_socket::read_u32()
+{
+    std::uint32_t val;
+    
+    read(&val, sizeof(val));
+    
+    return val;
+}
+
+std::string unix_socket::read_string(std::size_t max_size)
+{
+    auto size = read_u32();
+    if (size > max_size) {
+        std::string err_msg = "Received string of ";
+        err_msg += std::to_string(size);
+        err_msg += " bytes exceeds the limit of ";
+        err_msg += std::to_string(max_size);
+        err_msg += " bytes.";
+        
+        throw std::runtime_error(err_msg);
+    }
+    
+    std::string str(size, '\0');
+    
+    read(&str[0], str.size());
+    
+    return str;
+}
+
+unix_socket &unix_socket::operator=(unix_socket &&other)
+{
+    std::swap(_fd, other._fd);
+    
+    return *this;
+}
+
+void unix_socket::write(const void *buf, std::size_t size)
+{
+    auto p = static_cast<const char *>(buf);
+    
+    while (size > 0) {
+        /* Do not get killed by SIGPIPE if the other side went away */
+        auto n = send(_fd, p, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+                
+            throw_errno("send() failed");
+        }
+        
+        p += n;
+        size -= n;
+    }
+}
+
+void unix_socket::read(void *buf, std::size_t size)
+{
+    auto p = static_cast<char *>(buf);
+    
+    while (size > 0) {
+        auto n = recv(_fd, p, size, 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+                
+            throw_errno("recv() failed");
+        }
+        
+        if (n == 0)
+            throw std::runtime_error("Connection closed unexpectedly.");
+            
+        p += n;
+        size -= n;
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _UNIX_SOCKET_HPP_
+#define _UNIX_SOCKET_HPP_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/types.h>
+
+/* 
+ * Minimal wrapper around a unix domain stream socket. All numbers are
+ * transferred in host byte order: both ends always run on the same machine.
+ */
+class unix_socket {
+public:
+    unix_socket();
+    explicit unix_socket(int fd);
+    unix_socket(const unix_socket &other) = delete;
+    unix_socket(unix_socket &&other);
+    ~unix_socket();
+    
+    bool connect(const std::string &path);
+    void listen(const std::string &path);
+    unix_socket accept();
+    
+    bool valid() const;
+    
+    /* The user id of the process on the other end of the socket */
+    uid_t peer_uid() const;
+    
+    /* Reads and writes fail if they block for longer than 'seconds' */
+    void set_timeout(unsigned int seconds);
+    
+    /* 
+     * Creates the directory 'path' accessible only by the current user,
+     * unless it already exists. Returns false if the directory belongs
+     * to somebody else or may be accessed by other users.
+     */
+    static bool private_directory(const std::string &path);
+    
+    void write_u32(std::uint32_t val);
+    void write_string(const std::string &str);
+    std::uint32_t read_u32();
+    
+    /* Strings longer than 'max_size' are rejected before reading them */
+    std::string read_string(std::size_t max_size);
+    
+    unix_socket &operator=(const unix_socket &other) = delete;
+    unix_socket &operator=(unix_socket &&other);
+private:
+    void write(const void *buf, std::size_t size);
+    void read(void *buf, std::size_t size);
+    
+    int _fd;
+};
+
+#endif /* _UNIX_SOCKET_HPP_ */
@@ -23,10 +23,13 @@
 #include <boost/filesystem.hpp>
 
 #include "file.hpp"
+#include "run-stats.hpp"
 
 file::file(const std::string &path)
     : _path(path)
 {
+    run_stats::timer timer(run_stats::STAGE_FILES);
+    
     if (!fs::exists(_path.parent_path())) {
         bool ok = fs::create_directories(_path.parent_path());
         if (!ok)
@@ -27,37 +27,62 @@
 #include <utility>
 #include <memory>
 #include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
 
 #include <json/json.h>
 
 #include <boost/program_options.hpp>
 
 #include "adapter/query-adapter.hpp"
+#include "daemon/daemon-client.hpp"
+#include "daemon/daemon-server.hpp"
 #include "bookmarks.hpp"
+#include "result-queue.hpp"
+#include "run-stats.hpp"
+#include "tracer.hpp"
 #include "stream-opener.hpp"
+#include "watcher.hpp"
 
 #define DESC_ADD_B     "Add a new bookmark."
 #define DESC_CHANNELS  "Retrieve information about a channel."
 #define DESC_CHECK_B   "Check which bookmarks are streaming."
 #define DESC_CLI_ID    "Set the client id which will be used to make requests "\
                        "to the server."
+#define DESC_DAEMON    "Run in the background and answer the requests of "     \
+                       "other tq processes. Configuration, bookmarks and "     \
+                       "server connections stay loaded."
 #define DESC_DESC      "Print descriptive line headers, if applicable." 
 #define DESC_FEATURED  "Query featured streams."
 #define DESC_GAME      "Search streams showcasing game [arg]. The game name "  \
                        "must be a game shortcut or an exact match. "           \
                        "The configuration \"~/.config/tq/tq.conf\" showcases " \
                        "a few examples."
+#define DESC_FORMAT    "Set the output format: \"table\", or one line per "    \
+                       "stream, channel or game with \"ndjson\", \"tsv\" "     \
+                       "or \"csv\"."
 #define DESC_GET_B     "Show all currently saved bookmarks."
 #define DESC_HELP      "Print this help message."
+#define DESC_HTTP2     "Use HTTP/2 and multiplex all queries on a single "     \
+                       "connection, if supported by the server."
 #define DESC_JSON      "Pretty print the raw json responses from the server."
+#define DESC_RAW_JSON  "Print the json responses exactly as they were "        \
+                       "received from the server, without reformatting them."
 #define DESC_LIMIT     "Set the number of returned results."
 #define DESC_LIVE      "If searching for games: list only games that are "     \
                        "currently played on live streams."
+#define DESC_TRACE     "Write a trace of all requests and the time spent "     \
+                       "decoding and printing the results to file [arg]. "    \
+                       "It can be viewed with chrome://tracing or Perfetto."
+#define DESC_UNORDER   "Print the results in the order the queries complete "  \
+                       "instead of the order of the arguments."
 #define DESC_NO_SEC    "Do not print a section header, if applicable."
 #define DESC_REMOVE_B  "Remove a currently saved bookmark."
 #define DESC_SEARCH_C  "Search for channels with name [arg]."
 #define DESC_SEARCH_G  "Search for games with name [arg]."
 #define DESC_SEARCH_S  "Search for streams with name [arg]."
+#define DESC_STATS     "Print where the time of this run was spent to stderr."
 #define DESC_SHOW_SH   "Print all currently loaded game shortcuts. Shortcuts " \
                        "can be enabled in \"~/.config/tq/tq.conf\"."
 #define DESC_STREAMS   "Retrieve information about a stream. "                 \
@@ -68,6 +93,11 @@
 #define DESC_OPEN      "Open the stream for watching. A stream opener must be "\
                        "specified in \"~/.config/tq/tq.conf\"."
 #define DESC_OPEN_ARGS "Overwrite the arguments passed to the stream-opener."
+#define DESC_V_DELTA   "If watching: report streams whose number of viewers "  \
+                       "changed by at least [arg]."
+#define DESC_WATCH     "Check the bookmarks every [arg] (e.g. \"30s\" or "    \
+                       "\"5m\") and print only the streams which went live "  \
+                       "or offline or changed their game."
 
 #define VAL(arg)                                                               \
     opt::value((arg))
@@ -80,12 +110,91 @@ namespace opt = boost::program_options;
 const std::string home(std::getenv("HOME"));
 const std::string bookmarks_path = home + "/.config/tq/bookmarks";
 const std::string config_path    = home + "/.config/tq/tq.conf";
+const std::string session_path   = home + "/.config/tq/session-cache";
+const std::string rate_path      = home + "/.config/tq/rate-limit";
 
-bookmarks bookmarks(bookmarks_path);
-std::shared_ptr<config> conf(new config(config_path));
+/* 
+ * Configuration and bookmarks are only loaded if they are needed:
+ * a process which just forwards its arguments to the daemon 
+ * never touches them.
+ */
+static std::shared_ptr<config> get_config()
+{
+    static auto conf = std::make_shared<config>(config_path);
+    
+    return conf;
+}
 
-int main(int argc, char *argv[])
+static ::bookmarks &get_bookmarks()
 {
+    static ::bookmarks bookmarks(bookmarks_path);
+    
+    return bookmarks;
+}
+
+/* Cached responses can be deleted at any time, unlike the configuration */
+static std::string cache_path()
+{
+    auto cache_home = std::getenv("XDG_CACHE_HOME");
+    
+    /* Relative paths are to be ignored */
+    if (cache_home && cache_home[0] == '/')
+        return std::string(cache_home) + "/tq";
+        
+    return home + "/.cache/tq";
+}
+
+/* A daemon keeps answering from the same cache */
+static std::shared_ptr<response_cache> get_response_cache(const config &conf)
+{
+    static auto cache = conf.persistent_cache() ? 
+                        std::make_shared<response_cache>(cache_path()) :
+                        std::make_shared<response_cache>();
+                        
+    return cache;
+}
+
+/* The token bucket is shared with all other tq processes */
+static std::shared_ptr<rate_limiter> get_rate_limiter(const config &conf)
+{
+    static auto limiter = std::make_shared<rate_limiter>(
+                                        rate_path,
+                                        conf.rate_limit() / 60.0,
+                                        std::max(conf.rate_burst(), 1u));
+                                        
+    return limiter;
+}
+
+/* 
+ * The socket is kept in a directory only the user can access. An empty
+ * path is returned if there is no such directory.
+ */
+static std::string socket_path()
+{
+    auto runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    std::string dir;
+    
+    if (runtime_dir && *runtime_dir != '\0')
+        dir = runtime_dir;
+    else
+        dir = "/tmp/tq-" + std::to_string(geteuid());
+        
+    if (!unix_socket::private_directory(dir))
+        return std::string();
+        
+    return dir + "/tq.sock";
+}
+
+static int run(const std::vector<std::string> &args, 
+               std::ostream &out, 
+               std::ostream &err,
+               bool remote)
+{
+    run_stats stats;
+    auto status = EXIT_SUCCESS;
+    auto conf = get_config();
+    auto &bookmarks = get_bookmarks();
+    
     std::vector<std::string> add_vector;
     std::vector<std::string> channel_vector;
     std::vector<std::string> game_vector;
@@ -98,12 +207,16 @@ int main(int argc, char *argv[])
     std::vector<std::string> stream_vector;
     std::vector<std::string> user_vector;
     std::string client_id;
+    std::string format_name("table");
+    std::string trace_path;
+    std::string watch_interval;
+    unsigned int viewer_delta = 0;
     
     /* 'limit' will get overwritten if it is specified as a program argument */
     unsigned int limit = conf->limit();
     
     std::string usage("Usage: ");
-    usage += std::string(argv[0]);
+    usage += args[0];
     usage += " option1 [arg1][arg2]... option2 [arg1]...\n\nOptions";
     
     opt::options_description desc(usage);
@@ -113,37 +226,65 @@ int main(int argc, char *argv[])
         ("channels,C",        VAL_MUL(&channel_vector),         DESC_CHANNELS)
         ("check-bookmarks,b",                                   DESC_CHECK_B)
         ("client-id,i",       VAL(&client_id),                  DESC_CLI_ID)
+        ("daemon",                                              DESC_DAEMON)
         ("descriptive,d",                                       DESC_DESC)
         ("featured,f",                                          DESC_FEATURED)
+        ("format",            VAL(&format_name),                DESC_FORMAT)
         ("game,G",            VAL_MUL(&game_vector),            DESC_GAME)
         ("get-bookmarks",                                       DESC_GET_B)
         ("help,h",                                              DESC_HELP)
+        ("http2",                                               DESC_HTTP2)
         ("json,j",                                              DESC_JSON)
         ("limit",             VAL(&limit),                      DESC_LIMIT)
         ("live",                                                DESC_LIVE)
         ("no-section",                                          DESC_NO_SEC)
         ("open,o",            VAL_MUL(&open_vector),            DESC_OPEN)
         ("open-args",         VAL_MUL(&open_args_vector),       DESC_OPEN_ARGS)
+        ("raw-json",                                            DESC_RAW_JSON)
         ("remove-bookmark,r", VAL_MUL(&remove_vector),          DESC_REMOVE_B)
         ("search-channels,c", VAL_MUL(&search_channel_vector),  DESC_SEARCH_C)
         ("search-games,g",    VAL_MUL(&search_game_vector),     DESC_SEARCH_G)
         ("search-streams,s",  VAL_MUL(&search_stream_vector),   DESC_SEARCH_S)
         ("show-shortcuts",                                      DESC_SHOW_SH)
+        ("stats",                                               DESC_STATS)
         ("streams,S",         VAL_MUL(&stream_vector),          DESC_STREAMS)
         ("top,t",                                               DESC_TOP)
+        ("trace",             VAL(&trace_path),                 DESC_TRACE)
+        ("unordered",                                           DESC_UNORDER)
         ("user,u",            VAL_MUL(&user_vector),            DESC_USER)
-        ("verbose,v",                                           DESC_VERBOSE);
+        ("verbose,v",                                           DESC_VERBOSE)
+        ("viewer-delta",      VAL(&viewer_delta),               DESC_V_DELTA)
+        ("watch,w",           VAL(&watch_interval),             DESC_WATCH);
 
     try {
         opt::variables_map argv_map;
         
-        auto parsed = opt::parse_command_line(argc, argv, desc);
+        auto argv = std::vector<std::string>(args.begin() + 1, args.end());
+        
+        auto parsed = opt::command_line_parser(argv).options(desc).run();
         opt::store(parsed, argv_map);
         opt::notify(argv_map);
         
         if (argv_map.empty() || argv_map.count("help")) {
-            std::cout << desc << std::endl;
-            std::exit(EXIT_SUCCESS);
+            out << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        
+        /* Spawning the stream opener is left to the calling process */
+        if (remote && argv_map.count("open"))
+            return daemon_client::run_locally;
+            
+        /* A watching process would keep the daemon busy forever */
+        if (remote && argv_map.count("watch"))
+            return daemon_client::run_locally;
+            
+        /* The trace path is relative to the caller's working directory */
+        if (remote && argv_map.count("trace"))
+            return daemon_client::run_locally;
+            
+        if (argv_map.count("trace")) {
+            tracer::shared().start(trace_path);
+            tracer::shared().set_thread_name("main");
         }
         
         auto &shortcut_map = conf->game_shortcut_map();
@@ -152,7 +293,14 @@ int main(int argc, char *argv[])
         auto game_len = conf->game_length();
         
         auto desc = argv_map.count("descriptive") > 0 || conf->descriptive();
-        auto json = argv_map.count("json") > 0 || conf->json();
+        auto format = record_writer::parse_format(format_name);
+        auto records = format != record_format::table;
+        auto raw_json = argv_map.count("raw-json") > 0;
+        auto json = argv_map.count("json") > 0 || (conf->json() && !records);
+        
+        json = json || raw_json;
+        auto watch = argv_map.count("watch") > 0;
+        auto unordered = argv_map.count("unordered") > 0;
         auto no_section = argv_map.count("no-section") > 0 || !conf->section();
         auto verbose = argv_map.count("verbose") > 0 || conf->verbose();
         
@@ -181,10 +329,10 @@ int main(int argc, char *argv[])
             std::sort(shortcuts.begin(), shortcuts.end());
             
             if (!no_section)
-                std::cout << "[ Game Shortcuts ]:\n";
+                out << "[ Game Shortcuts ]:\n";
             
             for (const auto &x : shortcuts)
-                std::cout << x << "\n";
+                out << x << "\n";
         }
         
         auto stream_opener = ::stream_opener(conf);
@@ -198,33 +346,55 @@ int main(int argc, char *argv[])
             bookmarks.add(add_vector);
         
         if (argv_map.count("get-bookmarks"))
-            std::cout << bookmarks;
+            out << bookmarks;
         
         auto &cid = (!client_id.empty()) ? client_id : conf->client_id();
 
         query_adapter query_adapter(cid);
-        auto result_vector = query_adapter::result_vector();
-        
-        bool live = argv_map.count("live") > 0 || conf->live();
+        query_adapter.set_json(json && !watch);
+        query_adapter.set_base_url(conf->base_url());
+        query_adapter.set_http2(argv_map.count("http2") > 0 || conf->http2());
         
-        if (argv_map.count("check-bookmarks")) {
-            auto result = query_adapter.bookmarks(bookmarks.get());
+        if (conf->session_cache())
+            query_adapter.set_session_cache(session_path, conf->dns_ttl());
             
-            result_vector.push_back(std::move(result));
-        }
-        
-        for (const auto &x : channel_vector) {
-            auto result = query_adapter.channels(x);
+        if (conf->rate_limit() > 0)
+            query_adapter.set_rate_limiter(get_rate_limiter(*conf));
             
-            result_vector.push_back(std::move(result));
+        /* A watcher needs a fresh response on every poll */
+        if (conf->response_cache() && !watch) {
+            query_adapter.set_response_cache(get_response_cache(*conf));
+            query_adapter.set_stale_while_revalidate(
+                                            conf->stale_while_revalidate());
+                                            
+            for (const auto &x : conf->cache_ttl_map())
+                query_adapter.set_cache_ttl(x.first, x.second);
         }
-        
-        if (argv_map.count("featured")) {
-            auto result = query_adapter.featured_streams(limit);
             
-            result_vector.push_back(std::move(result));
+        /* Results printed by this run are seeded into the watcher */
+        auto watcher = ::watcher(query_adapter, bookmarks);
+        
+        if (watch) {
+            watcher.set_interval(config::parse_duration(watch_interval));
+            watcher.set_viewer_delta(viewer_delta);
         }
         
+        result_queue results;
+        
+        /* Overlapping channel lookups are merged into one */
+        query_adapter.begin_batch();
+        
+        bool live = argv_map.count("live") > 0 || conf->live();
+        
+        if (argv_map.count("check-bookmarks"))
+            query_adapter.bookmarks(bookmarks.get(), results.add());
+        
+        for (const auto &x : channel_vector)
+            query_adapter.channels(x, results.add());
+        
+        if (argv_map.count("featured"))
+            query_adapter.featured_streams(limit, results.add());
+        
         /* 
          * This query will only work if the game name matches exactly
          * with the one on the server. The config is capable of defining
@@ -243,69 +413,153 @@ int main(int argc, char *argv[])
             else
                 game = it->second;
             
-            auto result = query_adapter.streams(game, limit);
-            
-            result_vector.push_back(std::move(result));
+            query_adapter.streams(game, limit, results.add());
         }
         
-        for (const auto &x : search_channel_vector) {
-            auto result = query_adapter.search_channels(x, limit);
-            
-            result_vector.push_back(std::move(result));
-        }
+        for (const auto &x : search_channel_vector)
+            query_adapter.search_channels(x, limit, results.add());
         
-        for (const auto &x : search_game_vector) {
-            auto result = query_adapter.search_games(x, live);
-            
-            result_vector.push_back(std::move(result));
-        }
+        for (const auto &x : search_game_vector)
+            query_adapter.search_games(x, live, results.add());
         
-        for (const auto &x : search_stream_vector) {
-            auto result = query_adapter.search_streams(x, limit);
-            
-            result_vector.push_back(std::move(result));
-        }
+        for (const auto &x : search_stream_vector)
+            query_adapter.search_streams(x, limit, results.add());
         
-        if (argv_map.count("streams")) {
-            auto result = query_adapter.streams(stream_vector);
-            
-            result_vector.push_back(std::move(result));
-        }
+        if (argv_map.count("streams"))
+            query_adapter.streams(stream_vector, results.add());
+        
+        if (argv_map.count("top"))
+            query_adapter.top_games(limit, results.add());
+        
+        for (const auto &x : user_vector)
+            query_adapter.users(x, results.add());
+
+        query_adapter.end_batch();
         
-        if (argv_map.count("top")) {
-            auto result = query_adapter.top_games(limit);
+        /* The records of all results share the header of the first one */
+        auto header = desc;
+        
+        auto print = [&](result &res) {
+            res.set_integer_length(int_len);
+            res.set_name_length(name_len);
+            res.set_game_length(game_len);
+            res.set_descriptive((records) ? header : desc);
+            res.set_section(!no_section);
+            res.set_verbose(verbose);
+            
+            run_stats::timer timer(run_stats::STAGE_DUMP);
+            
+            /* The server refused the query */
+            if (dynamic_cast<error_result *>(&res))
+                status = EXIT_FAILURE;
+                
+            if (raw_json)
+                res.dump_raw_json(out);
+            else if (json)
+                res.dump_json(out);
+            else if (records)
+                res.dump_records(out, format);
+            else
+                res.dump(out);
+                
+            header = false;
             
-            result_vector.push_back(std::move(result));
+            /* Show the result right away instead of after the last one */
+            out.flush();
+            
+            /* The streams printed here are not reported again */
+            auto checked = dynamic_cast<bookmarks_result *>(&res);
+            if (watch && checked)
+                watcher.seed(*checked);
+        };
+        
+        /* 
+         * All queries are issued and running concurrently. Each result
+         * is printed as soon as it and all results before it are ready
+         * or, if the order does not matter, as soon as it is ready.
+         */
+        while (results.pending() > 0) {
+            auto future = (unordered) ? results.take_any() : 
+                                        results.take_next();
+                                        
+            print(*future.get());
         }
         
-        for (const auto &x : user_vector) {
-            auto result = query_adapter.users(x);
+        if (argv_map.count("stats"))
+            stats.dump(err, query_adapter.stats());
             
-            result_vector.push_back(std::move(result));
-        }
+        tracer::shared().stop();
+        
+        if (watch)
+            watcher.run(out, err);
+        
+    } catch (std::exception &e) {
+        err << "Exception: " << e.what() << std::endl;
+        status = EXIT_FAILURE;
+    }
 
-        /* 
-         * All queries are done and the results are collected.
-         * Time to print them.
-         */
+    return status;
+}
 
-        for (const auto &x : result_vector) {
-            x->set_integer_length(int_len);
-            x->set_name_length(name_len);
-            x->set_game_length(game_len);
-            x->set_descriptive(desc);
-            x->set_section(!no_section);
-            x->set_verbose(verbose);
+int main(int argc, char *argv[])
+{
+    auto args = std::vector<std::string>(argv, argv + argc);
+    
+    auto path = socket_path();
+    
+    if (std::find(args.begin(), args.end(), "--daemon") != args.end()) {
+        auto handler = [](const std::vector<std::string> &args,
+                          std::ostream &out,
+                          std::ostream &err) {
+            return run(args, out, err, true);
+        };
+        
+        try {
+            if (path.empty())
+                throw std::runtime_error("No private directory for the "
+                                         "daemon socket.");
+                                         
+            daemon_server server(path, handler);
             
-            if (json)
-                x->dump_json();
-            else
-                x->dump();
+            std::cout << "tq daemon listening on \"" << path << "\"." 
+                      << std::endl;
+                      
+            server.run();
+        } catch (std::exception &e) {
+            std::cerr << "Exception: " << e.what() << std::endl;
+            return EXIT_FAILURE;
         }
         
-    } catch (std::exception &e) {
-        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_SUCCESS;
     }
-
-    return EXIT_SUCCESS;
+    
+    /* 
+     * Let a running daemon do the work. If there is none or it fails,
+     * the command line is just run in this process.
+     */
+    try {
+        if (!path.empty()) {
+            daemon_client client(path);
+            
+            if (client.connected()) {
+                auto status = client.run(args, std::cout, std::cerr);
+                
+                if (status != daemon_client::run_locally)
+                    return status;
+            }
+        }
+    } catch (std::exception &) {
+        /* Fall back to running the command line in this process */
+    }
+    
+    auto status = run(args, std::cout, std::cerr, false);
+    
+    /* 
+     * Background refreshes are still drained when the url_engine is
+     * destroyed at exit. Readers of the output need not wait for them.
+     */
+    std::cout.flush();
+    std::fclose(stdout);
+    
+    return status;
 }
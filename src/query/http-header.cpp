@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cctype>
+
+#include "http-header.hpp"
+
+static void trim_spaces(std::string &str)
+{
+    auto it = str.begin();
+    
+    while (it != str.end() && std::isspace(*it))
+        ++it;
+        
+    str.erase(str.begin(), it);
+    
+    while (!str.empty() && std::isspace(str.back()))
+        str.pop_back();
+}
+
+http_header::http_header(const std::string &str)
+    : _fields()
+{
+    /* 
+     * Each response of a redirect chain starts with its status line.
+     * Only the fields of the last response are of interest.
+     */
+    auto begin = str.rfind("\nHTTP/");
+    if (begin == std::string::npos)
+        begin = 0;
+    else
+        ++begin;
+        
+    while (begin < str.size()) {
+        auto end = str.find('\n', begin);
+        if (end == std::string::npos)
+            end = str.size();
+            
+        auto colon = str.find(':', begin);
+        
+        if (colon < end) {
+            auto name = str.substr(begin, colon - begin);
+            auto value = str.substr(colon + 1, end - colon - 1);
+            
+            for (auto &x : name)
+                x = std::tolower(x);
+                
+            trim_spaces(name);
+            trim_spaces(value);
+            
+            _fields[std::move(name)] = std::move(value);
+        }
+        
+        begin = end + 1;
+    }
+}
+
+bool http_header::has(const std::string &name) const
+{
+    return _fields.count(name) > 0;
+}
+
+const std::string &http_header::get(const std::string &name) const
+{
+    static const std::string empty;
+    
+    auto it = _fields.find(name);
+    
+    return (it != _fields.end()) ? it->second : empty;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HTTP_HEADER_HPP_
+#define _HTTP_HEADER_HPP_
+
+#include <string>
+#include <unordered_map>
+
+/* 
+ * Parses the header fields of a response as received by libcurl. If
+ * the response was redirected, only the last header block is used.
+ * Field names are case-insensitive and stored in lower case.
+ */
+class http_header {
+public:
+    explicit http_header(const std::string &str);
+    
+    bool has(const std::string &name) const;
+    const std::string &get(const std::string &name) const;
+private:
+    std::unordered_map<std::string, std::string> _fields;
+};
+
+#endif /* _HTTP_HEADER_HPP_ */
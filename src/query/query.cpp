@@ -25,7 +25,7 @@
 
 #include "query.hpp"
 
-#define BASE_URL "https://api.twitch.tv/kraken/"
+#define DEFAULT_BASE_URL "https://api.twitch.tv/kraken/"
 
 static const std::string &stream_type_str(enum query::stream_type stream_type)
 {
@@ -38,6 +38,15 @@ static const std::string &stream_type_str(enum query::stream_type stream_type)
     return strings[stream_type];
 }
 
+static const char *endpoint_names[] = {
+    "channels",
+    "featured",
+    "search",
+    "streams",
+    "top",
+    "users",
+};
+
 static void throw_if_invalid_name(const std::string &str)
 {
     auto pred = [](char c) { return std::isspace(c); };
@@ -79,155 +88,241 @@ query::query(const std::string &client_id)
 
 query::query(const char *client_id)
     : _client(client_id),
-      _uri()
+      _base_url(DEFAULT_BASE_URL),
+      _ttl()
 {
-    _uri.reserve(1024);
 }
 
-std::string query::channels(const std::string &name)
+void query::channels(handler_ptr handler, const std::string &name)
 {
     throw_if_invalid_name(name);
     
-    _uri = BASE_URL "channels/";
-    _uri += name;
+    auto uri = _base_url;
+    uri += "channels/";
+    uri += name;
     
-    return _client.get_response(_uri);
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_CHANNELS]);
 }
 
-std::string query::featured_streams(unsigned int limit, unsigned int offset)
+void query::featured_streams(handler_ptr handler, 
+                             unsigned int limit, 
+                             unsigned int offset)
 {
     throw_if_invalid_limit(limit);
     
-    _uri = BASE_URL "streams/featured?limit=";
-    _uri += std::to_string(limit);
-    _uri += "&offset=";
-    _uri += std::to_string(offset);
+    auto uri = _base_url;
+    uri += "streams/featured?limit=";
+    uri += std::to_string(limit);
+    uri += "&offset=";
+    uri += std::to_string(offset);
     
-    return _client.get_response(_uri);
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_FEATURED]);
 }
 
-std::string query::search_channels(const std::string &query, 
-                                   unsigned int limit, 
-                                   unsigned int offset)
+void query::search_channels(handler_ptr handler,
+                            const std::string &query, 
+                            unsigned int limit, 
+                            unsigned int offset)
 {
     throw_if_invalid_limit(limit);
     
-    _uri = BASE_URL "search/channels?q=";
-    _uri += query;
-    _uri += "&limit=";
-    _uri += std::to_string(limit);
-    _uri += "&offset=";
-    _uri += std::to_string(offset);
+    auto uri = _base_url;
+    uri += "search/channels?q=";
+    uri += query;
+    uri += "&limit=";
+    uri += std::to_string(limit);
+    uri += "&offset=";
+    uri += std::to_string(offset);
     
-    return _client.get_response(_uri);
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_SEARCH]);
 }
 
-std::string query::search_games(const std::string &query, const bool *live)
+void query::search_games(handler_ptr handler, 
+                         const std::string &query, 
+                         const bool *live)
 {
-    _uri = BASE_URL "search/games?q=";
-    _uri += query;
-    _uri += "&type=suggest";
+    auto uri = _base_url;
+    uri += "search/games?q=";
+    uri += query;
+    uri += "&type=suggest";
     
     if (live) {
-        _uri += "&live=";
-        _uri += (*live) ? "true" : "false";
+        uri += "&live=";
+        uri += (*live) ? "true" : "false";
     }
     
-    return _client.get_response(_uri);
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_SEARCH]);
 }
 
-std::string query::search_streams(const std::string &query, 
-                                  unsigned int limit, 
-                                  unsigned int offset, 
-                                  const bool *hls)
+void query::search_streams(handler_ptr handler,
+                           const std::string &query, 
+                           unsigned int limit, 
+                           unsigned int offset, 
+                           const bool *hls)
 {
     throw_if_invalid_limit(limit);
     
-    _uri = BASE_URL "search/streams?q=";
-    _uri += query;
-    _uri += "&limit=";
-    _uri += std::to_string(limit);
-    _uri += "&offset=";
-    _uri += std::to_string(offset);
+    auto uri = _base_url;
+    uri += "search/streams?q=";
+    uri += query;
+    uri += "&limit=";
+    uri += std::to_string(limit);
+    uri += "&offset=";
+    uri += std::to_string(offset);
     
     if (hls) {
-        _uri += "&hls=";
-        _uri += (*hls) ? "true" : "false";
+        uri += "&hls=";
+        uri += (*hls) ? "true" : "false";
     }
     
-    return _client.get_response(_uri);
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_SEARCH]);
 }
 
-std::string query::streams(const std::string *game, 
-                           const std::vector<std::string> *channels, 
-                           const unsigned int limit, 
-                           const unsigned int offset, 
-                           const std::string *client_id, 
-                           query::stream_type *stream_type)
+void query::streams(handler_ptr handler,
+                    const std::string *game, 
+                    const std::vector<std::string> *channels, 
+                    const unsigned int limit, 
+                    const unsigned int offset, 
+                    const std::string *client_id, 
+                    query::stream_type *stream_type)
 {
     throw_if_invalid_limit(limit);
     
-    _uri = BASE_URL "streams?";
+    auto uri = _base_url;
+    uri += "streams?";
     
     if (game && !game->empty()) {
         throw_if_invalid_name(*game);
         
-        _uri += "game=";
-        _uri += *game;
-        _uri += '&';
+        uri += "game=";
+        uri += *game;
+        uri += '&';
     }
     
     if (channels && !channels->empty()) {
-        _uri += "channel=";
+        uri += "channel=";
         
         for (const auto &x : *channels) {
             throw_if_invalid_name(x);
             
-            _uri += x;
-            _uri += ',';
+            uri += x;
+            uri += ',';
         }
         
         /* Remove last ',' */
-        _uri.pop_back();
-        _uri += '&';
+        uri.pop_back();
+        uri += '&';
     }
     
-    _uri += "limit=";
-    _uri += std::to_string(limit);
-    _uri += "&offset=";
-    _uri += std::to_string(offset);
+    uri += "limit=";
+    uri += std::to_string(limit);
+    uri += "&offset=";
+    uri += std::to_string(offset);
     
     if (client_id && !client_id->empty()) {
-        _uri += "&client_id=";
-        _uri += *client_id;
+        uri += "&client_id=";
+        uri += *client_id;
     }
     
     if (stream_type) {
-        _uri += "&stream_type=";
-        _uri += stream_type_str(*stream_type);
+        uri += "&stream_type=";
+        uri += stream_type_str(*stream_type);
     }
     
-    return _client.get_response(_uri);
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_STREAMS]);
 }
 
-std::string query::top_games(unsigned int limit, unsigned int offset)
+void query::top_games(handler_ptr handler, 
+                      unsigned int limit, 
+                      unsigned int offset)
 {
     throw_if_invalid_limit(limit);
     
-    _uri = BASE_URL "games/top?limit=";
-    _uri += std::to_string(limit);
-    _uri += "&offset=";
-    _uri += std::to_string(offset);
+    auto uri = _base_url;
+    uri += "games/top?limit=";
+    uri += std::to_string(limit);
+    uri += "&offset=";
+    uri += std::to_string(offset);
     
-    return _client.get_response(_uri);
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_TOP]);
 }
 
-std::string query::users(const std::string &name)
+void query::users(handler_ptr handler, const std::string &name)
 {
     throw_if_invalid_name(name);
     
-    _uri = BASE_URL "users/";
-    _uri += name;
+    auto uri = _base_url;
+    uri += "users/";
+    uri += name;
+    
+    _client.get_response_async(uri, 
+                               std::move(handler), 
+                               _ttl[ENDPOINT_USERS]);
+}
+
+void query::set_base_url(const std::string &url)
+{
+    if (url.empty())
+        throw std::invalid_argument("The base url must not be empty.");
+        
+    _base_url = url;
+    
+    if (_base_url.back() != '/')
+        _base_url += '/';
+}
+
+const url_client::statistics &query::stats() const
+{
+    return _client.stats();
+}
+
+void query::set_http2(bool val)
+{
+    _client.set_http2(val);
+}
+
+void query::set_session_cache(const std::string &path, unsigned int dns_ttl)
+{
+    _client.set_session_cache(path, dns_ttl);
+}
+
+void query::set_response_cache(std::shared_ptr<response_cache> cache)
+{
+    _client.set_response_cache(std::move(cache));
+}
+
+void query::set_stale_while_revalidate(bool val)
+{
+    _client.set_stale_while_revalidate(val);
+}
+
+void query::set_rate_limiter(std::shared_ptr<rate_limiter> limiter)
+{
+    _client.set_rate_limiter(std::move(limiter));
+}
+
+void query::set_cache_ttl(const std::string &endpoint, unsigned int ttl)
+{
+    for (int i = 0; i < ENDPOINT_MAX; ++i) {
+        if (endpoint == endpoint_names[i]) {
+            _ttl[i] = ttl;
+            return;
+        }
+    }
     
-    return _client.get_response(_uri);
+    throw std::invalid_argument("Invalid endpoint \"" + endpoint + "\"");
 }
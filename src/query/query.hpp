@@ -23,9 +23,15 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include "url-client.hpp"
 
+/*
+ * Builds the requests for the endpoints of the twitch.tv API. Queries
+ * may be issued by any number of threads at once, the settings are
+ * supposed to be made before the first query.
+ */
 class query {
 public:
     enum stream_type {
@@ -34,37 +40,80 @@ public:
         STREAM_TYPE_LIVE,
     };
     
+    typedef std::shared_ptr<url_client::handler> handler_ptr;
+    
     query(const std::string &client_id);
     query(const char *client_id);
     
-    std::string channels(const std::string &name);
-    std::string featured_streams(unsigned int limit = 25, 
-                                 unsigned int offset = 0);
-    std::string search_channels(const std::string &query,
-                                unsigned int limit = 25,
-                                unsigned int offset = 0);
-    std::string search_games(const std::string &query,
-                             const bool *live = nullptr);
-    std::string search_streams(const std::string &query,
-                               unsigned int limit = 25,
-                               unsigned int offset = 0,
-                               const bool *hls = nullptr);
+    /* 
+     * All queries are asynchronous: the response is passed to
+     * 'handler' as soon as it was received.
+     */
+    void channels(handler_ptr handler, const std::string &name);
+    void featured_streams(handler_ptr handler,
+                          unsigned int limit = 25, 
+                          unsigned int offset = 0);
+    void search_channels(handler_ptr handler,
+                         const std::string &query,
+                         unsigned int limit = 25,
+                         unsigned int offset = 0);
+    void search_games(handler_ptr handler,
+                      const std::string &query,
+                      const bool *live = nullptr);
+    void search_streams(handler_ptr handler,
+                        const std::string &query,
+                        unsigned int limit = 25,
+                        unsigned int offset = 0,
+                        const bool *hls = nullptr);
     
-    std::string streams(const std::string *game = nullptr,
-                        const std::vector<std::string> *channels = nullptr,
-                        const unsigned int limit = 25,
-                        const unsigned int offset = 0,
-                        const std::string *client_id = nullptr,
-                        enum stream_type *stream_type = nullptr);
+    void streams(handler_ptr handler,
+                 const std::string *game = nullptr,
+                 const std::vector<std::string> *channels = nullptr,
+                 const unsigned int limit = 25,
+                 const unsigned int offset = 0,
+                 const std::string *client_id = nullptr,
+                 enum stream_type *stream_type = nullptr);
     
-    std::string top_games(unsigned int limit = 10, 
-                          unsigned int offset = 0);
+    void top_games(handler_ptr handler,
+                   unsigned int limit = 10, 
+                   unsigned int offset = 0);
     
     
-    std::string users(const std::string &name);
+    void users(handler_ptr handler, const std::string &name);
+    
+    /* 
+     * Sends all queries to the server at 'url' instead of the twitch.tv
+     * API, e.g. "http://127.0.0.1:8089/kraken/"
+     */
+    void set_base_url(const std::string &url);
+    void set_http2(bool val);
+    void set_session_cache(const std::string &path, unsigned int dns_ttl);
+    void set_response_cache(std::shared_ptr<response_cache> cache);
+    void set_stale_while_revalidate(bool val);
+    void set_rate_limiter(std::shared_ptr<rate_limiter> limiter);
+    
+    /* 
+     * Cached responses of 'endpoint' ("channels", "featured", "search",
+     * "streams", "top" or "users") are used for 'ttl' seconds without
+     * asking the server.
+     */
+    void set_cache_ttl(const std::string &endpoint, unsigned int ttl);
+    
+    const url_client::statistics &stats() const;
 private:
+    enum endpoint {
+        ENDPOINT_CHANNELS,
+        ENDPOINT_FEATURED,
+        ENDPOINT_SEARCH,
+        ENDPOINT_STREAMS,
+        ENDPOINT_TOP,
+        ENDPOINT_USERS,
+        ENDPOINT_MAX,
+    };
+    
     url_client _client;
-    std::string _uri;
+    std::string _base_url;
+    unsigned int _ttl[ENDPOINT_MAX];
 };
 
 #endif /* _QUERY_HPP_ */
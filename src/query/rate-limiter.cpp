@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#include "rate-limiter.hpp"
+
+static long long to_ms(std::chrono::system_clock::time_point time)
+{
+    using std::chrono::milliseconds;
+    
+    auto since_epoch = time.time_since_epoch();
+    
+    return std::chrono::duration_cast<milliseconds>(since_epoch).count();
+}
+
+static long long now_ms()
+{
+    return to_ms(std::chrono::system_clock::now());
+}
+
+rate_limiter::rate_limiter(double rate, double burst)
+    : rate_limiter(std::string(), rate, burst)
+{
+}
+
+rate_limiter::rate_limiter(const std::string &path, double rate, double burst)
+    : _mutex(),
+      _path(path),
+      _state { burst, now_ms(), 0 },
+      _rate(rate),
+      _burst(burst)
+{
+}
+
+std::chrono::milliseconds rate_limiter::reserve()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    auto fd = lock_state_file();
+    auto now = now_ms();
+    
+    auto elapsed = std::max(now - _state.update, 0LL);
+    
+    _state.tokens += elapsed * _rate / 1000.0;
+    _state.tokens = std::min(_state.tokens, _burst);
+    _state.update = now;
+    
+    /* The token may be borrowed from the future */
+    _state.tokens -= 1.0;
+    
+    auto wait = 0LL;
+    
+    if (_state.tokens < 0.0)
+        wait = (long long) (-_state.tokens * 1000.0 / _rate);
+        
+    wait = std::max(wait, _state.blocked - now);
+    
+    unlock_state_file(fd);
+    
+    return std::chrono::milliseconds(wait);
+}
+
+void rate_limiter::block_until(std::chrono::system_clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    auto fd = lock_state_file();
+    
+    _state.blocked = std::max(_state.blocked, to_ms(time));
+    
+    unlock_state_file(fd);
+}
+
+int rate_limiter::lock_state_file()
+{
+    if (_path.empty())
+        return -1;
+        
+    /* Without a usable state file the bucket is just not shared */
+    auto fd = open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -1;
+        
+    if (flock(fd, LOCK_EX) < 0) {
+        close(fd);
+        return -1;
+    }
+    
+    char buffer[128];
+    auto n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    
+    if (n > 0) {
+        std::istringstream stream(std::string(buffer, n));
+        auto state = rate_limiter::state { 0.0, 0, 0 };
+        
+        stream >> state.tokens >> state.update >> state.blocked;
+        
+        if (!stream.fail())
+            _state = state;
+    }
+    
+    return fd;
+}
+
+void rate_limiter::unlock_state_file(int fd)
+{
+    if (fd < 0)
+        return;
+        
+    std::ostringstream stream;
+    stream << _state.tokens << " " << _state.update << " " 
+           << _state.blocked << "\n";
+           
+    auto str = stream.str();
+    
+    if (ftruncate(fd, 0) == 0)
+        (void) pwrite(fd, str.data(), str.size(), 0);
+        
+    /* Closing the file releases the lock */
+    close(fd);
+}
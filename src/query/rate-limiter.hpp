@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RATE_LIMITER_HPP_
+#define _RATE_LIMITER_HPP_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+/*
+ * A token bucket which allows 'burst' requests at once and refills at
+ * 'rate' requests per second. Requests are never rejected: each one 
+ * reserves a token and is told how long to wait for it.
+ *
+ * With a state file, the bucket is shared by all tq processes. The file
+ * is locked while a token is reserved.
+ */
+class rate_limiter {
+public:
+    rate_limiter(double rate, double burst);
+    rate_limiter(const std::string &path, double rate, double burst);
+    
+    std::chrono::milliseconds reserve();
+    
+    /* No request is sent before 'time', e.g. as told by the server */
+    void block_until(std::chrono::system_clock::time_point time);
+private:
+    struct state {
+        double tokens;
+        
+        /* Milliseconds since the epoch */
+        long long update;
+        long long blocked;
+    };
+    
+    int lock_state_file();
+    void unlock_state_file(int fd);
+    
+    std::mutex _mutex;
+    std::string _path;
+    state _state;
+    double _rate;
+    double _burst;
+};
+
+#endif /* _RATE_LIMITER_HPP_ */
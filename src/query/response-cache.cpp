@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "response-cache.hpp"
+
+/* Files of the cache directory are deleted after this many seconds */
+#define MAX_FILE_AGE (7 * 24 * 60 * 60)
+
+/* The oldest files are deleted while the directory is larger than this */
+#define MAX_DIR_SIZE (32u << 20)
+
+/* The cache directory is checked at most this often by all processes */
+#define PRUNE_INTERVAL (60 * 60)
+
+/* Returns -1 if the response must not be cached at all */
+static long max_age(const http_header &header)
+{
+    const auto &cache_control = header.get("cache-control");
+    std::istringstream stream(cache_control);
+    std::string directive;
+    long age = 0;
+    
+    while (std::getline(stream, directive, ',')) {
+        auto begin = directive.find_first_not_of(' ');
+        if (begin == std::string::npos)
+            continue;
+            
+        directive.erase(0, begin);
+        
+        for (auto &x : directive)
+            x = std::tolower(x);
+            
+        if (directive.compare(0, 8, "no-store") == 0)
+            return -1;
+            
+        if (directive.compare(0, 8, "no-cache") == 0)
+            return 0;
+            
+        if (directive.compare(0, 8, "max-age=") == 0)
+            age = std::strtol(directive.c_str() + 8, nullptr, 10);
+    }
+    
+    /* The response might already have been sitting in a proxy cache */
+    age -= std::strtol(header.get("age").c_str(), nullptr, 10);
+    
+    return (age > 0) ? age : 0;
+}
+
+response_cache::response_cache(std::size_t max_entries)
+    : _mutex(),
+      _map(),
+      _order(),
+      _dir(),
+      _max_entries(max_entries),
+      _next_prune(0)
+{
+}
+
+response_cache::response_cache(const std::string &dir, 
+                               std::size_t max_entries)
+    : response_cache(max_entries)
+{
+    _dir = dir;
+    
+    if (!fs::exists(_dir)) {
+        bool ok = fs::create_directories(_dir);
+        if (!ok)
+            throw std::runtime_error("Failed to create directories.");
+    }
+    
+    if (!fs::is_directory(_dir)) {
+        std::string d(_dir.c_str());
+        throw std::runtime_error("\"" + d + "\" is not a directory.");
+    }
+    
+    prune(std::time(nullptr));
+}
+
+bool response_cache::find(const std::string &uri, entry &entry)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    auto it = _map.find(uri);
+    if (it != _map.end()) {
+        entry = it->second;
+        return true;
+    }
+    
+    if (!load(uri, entry))
+        return false;
+        
+    insert(uri, entry);
+    
+    return true;
+}
+
+void response_cache::store(const std::string &uri, 
+                           const http_header &header, 
+                           const std::string &body)
+{
+    auto age = max_age(header);
+    auto now = std::time(nullptr);
+    
+    auto new_entry = entry {
+        header.get("etag"),
+        header.get("last-modified"),
+        now,
+        now + age,
+        std::make_shared<const std::string>(body)
+    };
+    
+    if (age < 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        
+        if (_map.erase(uri) > 0) {
+            auto it = std::find(_order.begin(), _order.end(), uri);
+            _order.erase(it);
+        }
+        
+        if (!_dir.empty()) {
+            boost::system::error_code ec;
+            fs::remove(path(uri), ec);
+        }
+        
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    save(uri, new_entry);
+    insert(uri, std::move(new_entry));
+    
+    /* A daemon keeps on adding files */
+    if (now >= _next_prune)
+        prune(now);
+}
+
+std::shared_ptr<const std::string> 
+response_cache::refresh(const std::string &uri, const http_header &header)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    auto it = _map.find(uri);
+    if (it == _map.end())
+        return nullptr;
+        
+    auto &entry = it->second;
+    auto age = max_age(header);
+    
+    /* A 304 response may update the metadata of the stored response */
+    if (header.has("etag"))
+        entry.etag = header.get("etag");
+        
+    if (header.has("last-modified"))
+        entry.last_modified = header.get("last-modified");
+        
+    entry.date = std::time(nullptr);
+    entry.expires = entry.date + ((age > 0) ? age : 0);
+    
+    save(uri, entry);
+    
+    return entry.body;
+}
+
+void response_cache::insert(const std::string &uri, entry entry)
+{
+    auto it = _map.find(uri);
+    if (it != _map.end()) {
+        it->second = std::move(entry);
+        return;
+    }
+    
+    _map.insert({ uri, std::move(entry) });
+    _order.push_back(uri);
+    
+    /* Evict the oldest entries, they are likely to be stale anyway */
+    while (_order.size() > _max_entries) {
+        _map.erase(_order.front());
+        _order.pop_front();
+    }
+}
+
+fs::path response_cache::path(const std::string &uri) const
+{
+    /* FNV-1a */
+    std::uint64_t hash = 0xcbf29ce484222325;
+    
+    for (auto c : uri) {
+        hash ^= (unsigned char) c;
+        hash *= 0x100000001b3;
+    }
+    
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash);
+    
+    return _dir / name;
+}
+
+bool response_cache::load(const std::string &uri, entry &entry) const
+{
+    if (_dir.empty())
+        return false;
+        
+    std::ifstream reader(path(uri).c_str(), std::ios::in);
+    std::string line;
+    
+    entry = response_cache::entry { "", "", 0, 0, nullptr };
+    
+    while (std::getline(reader, line) && !line.empty()) {
+        auto pos = line.find(' ');
+        if (pos == std::string::npos)
+            continue;
+            
+        auto key = line.substr(0, pos);
+        auto value = line.substr(pos + 1);
+        
+        /* Two URIs with the same hash */
+        if (key == "uri" && value != uri)
+            return false;
+        else if (key == "etag")
+            entry.etag = std::move(value);
+        else if (key == "last-modified")
+            entry.last_modified = std::move(value);
+        else if (key == "date")
+            entry.date = std::strtoll(value.c_str(), nullptr, 10);
+        else if (key == "expires")
+            entry.expires = std::strtoll(value.c_str(), nullptr, 10);
+    }
+    
+    if (!reader)
+        return false;
+        
+    std::string body((std::istreambuf_iterator<char>(reader)),
+                     std::istreambuf_iterator<char>());
+                     
+    entry.body = std::make_shared<const std::string>(std::move(body));
+    
+    return true;
+}
+
+void response_cache::save(const std::string &uri, const entry &entry) const
+{
+    if (_dir.empty())
+        return;
+        
+    std::ostringstream stream;
+    
+    stream << "uri " << uri << "\n"
+           << "etag " << entry.etag << "\n"
+           << "last-modified " << entry.last_modified << "\n"
+           << "date " << (long long) entry.date << "\n"
+           << "expires " << (long long) entry.expires << "\n"
+           << "\n"
+           << *entry.body;
+           
+    auto data = stream.str();
+    
+    /* Each writer, also of another process, needs its own file */
+    auto file_path = path(uri);
+    auto tmp_path = file_path.string() + ".XXXXXX";
+    
+    int fd = mkstemp(&tmp_path[0]);
+    if (fd < 0)
+        return;
+        
+    std::size_t n = 0;
+    
+    while (n < data.size()) {
+        auto ret = write(fd, data.data() + n, data.size() - n);
+        if (ret < 0 && errno == EINTR)
+            continue;
+            
+        if (ret < 0)
+            break;
+            
+        n += ret;
+    }
+    
+    auto ok = close(fd) == 0 && n == data.size();
+    
+    /* Concurrent readers either see the old or the new response */
+    boost::system::error_code ec;
+    
+    if (ok)
+        fs::rename(tmp_path, file_path, ec);
+        
+    if (!ok || ec)
+        fs::remove(tmp_path, ec);
+}
+
+void response_cache::prune(std::time_t now)
+{
+    struct file {
+        std::time_t time;
+        std::uintmax_t size;
+        fs::path path;
+    };
+    
+    _next_prune = now + PRUNE_INTERVAL;
+    
+    /* Another process may have pruned the directory recently */
+    auto stamp = _dir / "pruned";
+    boost::system::error_code ec;
+    
+    auto last = fs::last_write_time(stamp, ec);
+    if (!ec && last <= now && now - last < PRUNE_INTERVAL)
+        return;
+        
+    std::ofstream(stamp.c_str(), std::ios::out | std::ios::trunc);
+    fs::last_write_time(stamp, now, ec);
+    
+    auto files = std::vector<file>();
+    std::uintmax_t total = 0;
+    
+    fs::directory_iterator it(_dir, ec), end;
+    
+    for (; !ec && it != end; it.increment(ec)) {
+        const auto &path = it->path();
+        boost::system::error_code file_ec;
+        
+        if (path == stamp || !fs::is_regular_file(it->status()))
+            continue;
+            
+        auto time = fs::last_write_time(path, file_ec);
+        auto size = fs::file_size(path, file_ec);
+        if (file_ec)
+            continue;
+            
+        if (now - time > MAX_FILE_AGE) {
+            fs::remove(path, file_ec);
+            continue;
+        }
+        
+        files.push_back({ time, size, path });
+        total += size;
+    }
+    
+    if (total <= MAX_DIR_SIZE)
+        return;
+        
+    std::sort(files.begin(), files.end(), [](const file &a, const file &b) {
+        return a.time < b.time;
+    });
+    
+    for (const auto &x : files) {
+        if (total <= MAX_DIR_SIZE)
+            break;
+            
+        fs::remove(x.path, ec);
+        total -= x.size;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RESPONSE_CACHE_HPP_
+#define _RESPONSE_CACHE_HPP_
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <ctime>
+#include <unordered_map>
+
+#include <boost/filesystem.hpp>
+
+#include "http-header.hpp"
+
+namespace fs = boost::filesystem;
+
+/*
+ * Keeps the responses of successful requests together with their
+ * validators (ETag, Last-Modified) and the freshness lifetime announced
+ * by Cache-Control. Fresh responses can be served without a request,
+ * stale ones are revalidated with a conditional request. 'date' is the
+ * time the response was received or last validated, so users may apply
+ * their own lifetime on top of Cache-Control.
+ *
+ * If a directory is given, every response is also written to its own
+ * file so it survives the process. Old files are deleted from time to 
+ * time and the oldest ones also if the directory grows too large.
+ */
+class response_cache {
+public:
+    struct entry {
+        std::string etag;
+        std::string last_modified;
+        std::time_t date;
+        std::time_t expires;
+        std::shared_ptr<const std::string> body;
+    };
+    
+    explicit response_cache(std::size_t max_entries = 256);
+    response_cache(const std::string &dir, std::size_t max_entries = 256);
+    response_cache(const response_cache &other) = delete;
+    
+    bool find(const std::string &uri, entry &entry);
+    
+    void store(const std::string &uri, 
+               const http_header &header, 
+               const std::string &body);
+    std::shared_ptr<const std::string> refresh(const std::string &uri, 
+                                               const http_header &header);
+                                               
+    response_cache &operator=(const response_cache &other) = delete;
+private:
+    void insert(const std::string &uri, entry entry);
+    
+    fs::path path(const std::string &uri) const;
+    bool load(const std::string &uri, entry &entry) const;
+    void save(const std::string &uri, const entry &entry) const;
+    void prune(std::time_t now);
+    
+    std::mutex _mutex;
+    std::unordered_map<std::string, entry> _map;
+    std::deque<std::string> _order;
+    fs::path _dir;
+    std::size_t _max_entries;
+    std::time_t _next_prune;
+};
+
+#endif /* _RESPONSE_CACHE_HPP_ */
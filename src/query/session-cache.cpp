@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <limits>
+#include <stdexcept>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "session-cache.hpp"
+
+/* Exporting and importing TLS sessions is only possible since curl 8.12 */
+#if LIBCURL_VERSION_NUM >= 0x080c00
+#define HAVE_SSLS_EXPORT
+#endif
+
+#ifdef HAVE_SSLS_EXPORT
+
+static std::string hex_encode(const unsigned char *data, std::size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string str;
+    
+    str.reserve(2 * size);
+    
+    for (std::size_t i = 0; i < size; ++i) {
+        str += digits[data[i] >> 4];
+        str += digits[data[i] & 0x0f];
+    }
+    
+    return str;
+}
+
+static std::string hex_decode(const std::string &str)
+{
+    auto value = [](char c) {
+        return (c >= 'a') ? c - 'a' + 10 : c - '0';
+    };
+    
+    std::string data;
+    data.reserve(str.size() / 2);
+    
+    for (std::size_t i = 0; i + 1 < str.size(); i += 2)
+        data += (char) ((value(str[i]) << 4) | value(str[i + 1]));
+        
+    return data;
+}
+
+static CURLcode export_session(CURL *curl,
+                               void *arg,
+                               const char *session_key,
+                               const unsigned char *shmac,
+                               size_t shmac_len,
+                               const unsigned char *sdata,
+                               size_t sdata_len,
+                               curl_off_t valid_until,
+                               int ietf_tls_id,
+                               const char *alpn,
+                               size_t earlydata_max)
+{
+    (void) curl;
+    (void) ietf_tls_id;
+    (void) alpn;
+    (void) earlydata_max;
+    
+    auto writer = static_cast<std::ostream *>(arg);
+    auto key = (const unsigned char *) session_key;
+    auto key_len = std::strlen(session_key);
+    
+    if (!shmac || !sdata || valid_until <= std::time(nullptr))
+        return CURLE_OK;
+        
+    *writer << "tls " << valid_until
+            << " " << hex_encode(key, key_len)
+            << " " << hex_encode(shmac, shmac_len)
+            << " " << hex_encode(sdata, sdata_len) << "\n";
+            
+    return CURLE_OK;
+}
+
+#endif /* HAVE_SSLS_EXPORT */
+
+static std::string resolve_host(CURL *curl)
+{
+    char *url = nullptr;
+    char *host = nullptr;
+    long port = 0;
+    
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    curl_easy_getinfo(curl, CURLINFO_PRIMARY_PORT, &port);
+    
+    if (!url || port <= 0)
+        return std::string();
+        
+    auto curlu = curl_url();
+    if (!curlu)
+        return std::string();
+        
+    auto ok = curl_url_set(curlu, CURLUPART_URL, url, 0);
+    if (ok == CURLUE_OK)
+        ok = curl_url_get(curlu, CURLUPART_HOST, &host, 0);
+        
+    curl_url_cleanup(curlu);
+    
+    if (ok != CURLUE_OK)
+        return std::string();
+        
+    std::string str(host);
+    str += ':';
+    str += std::to_string(port);
+    
+    curl_free(host);
+    
+    return str;
+}
+
+session_cache::session_cache(const std::string &path, unsigned int dns_ttl)
+    : file(path),
+      _mutex(),
+      _dns_map(),
+      _removed(),
+      _resolve_list(),
+      _next_expiry(0),
+      _dns_ttl(dns_ttl),
+      _dirty(false)
+{
+    /* TLS session tickets are secrets of the user */
+    chmod(c_str(), S_IRUSR | S_IWUSR);
+}
+
+void session_cache::load(CURLSH *curlsh)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    std::ifstream reader(c_str(), std::ios::in);
+    std::string line;
+    
+    auto now = std::time(nullptr);
+    
+#ifdef HAVE_SSLS_EXPORT
+    /* Sessions are imported into the share used by all transfers */
+    auto curl = curl_easy_init();
+    if (curl)
+        curl_easy_setopt(curl, CURLOPT_SHARE, curlsh);
+#else
+    (void) curlsh;
+#endif
+
+    while (std::getline(reader, line)) {
+        std::istringstream stream(line);
+        std::string type;
+        
+        stream >> type;
+        
+        if (type == "dns") {
+            std::string host, address;
+            long long expires = 0;
+            
+            stream >> host >> address >> expires;
+            
+            if (stream.fail() || expires <= now)
+                continue;
+                
+            auto entry = dns_entry { std::move(address), expires };
+            _dns_map.insert({ std::move(host), std::move(entry) });
+        }
+        
+#ifdef HAVE_SSLS_EXPORT
+        if (type == "tls" && curl) {
+            std::string key, shmac, sdata;
+            long long expires = 0;
+            
+            stream >> expires >> key >> shmac >> sdata;
+            
+            if (stream.fail() || expires <= now)
+                continue;
+                
+            key = hex_decode(key);
+            shmac = hex_decode(shmac);
+            sdata = hex_decode(sdata);
+            
+            /* Sessions from a different TLS backend are just rejected */
+            curl_easy_ssls_import(curl,
+                                  key.c_str(),
+                                  (const unsigned char *) shmac.data(),
+                                  shmac.size(),
+                                  (const unsigned char *) sdata.data(),
+                                  sdata.size());
+        }
+#endif
+    }
+    
+#ifdef HAVE_SSLS_EXPORT
+    curl_easy_cleanup(curl);
+#endif
+
+    update_resolve_list();
+}
+
+void session_cache::save(CURLSH *curlsh)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    if (!_dirty)
+        return;
+        
+    std::ostringstream writer;
+    
+    auto now = std::time(nullptr);
+    
+    writer << "# tq session cache - generated file, do not edit\n";
+    
+    for (const auto &x : _dns_map) {
+        if (x.second.expires > now) {
+            writer << "dns " << x.first << " " << x.second.address
+                   << " " << (long long) x.second.expires << "\n";
+        }
+    }
+    
+#ifdef HAVE_SSLS_EXPORT
+    auto curl = curl_easy_init();
+    if (curl) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, curlsh);
+        auto stream = static_cast<std::ostream *>(&writer);
+        curl_easy_ssls_export(curl, &export_session, stream);
+        curl_easy_cleanup(curl);
+    }
+#else
+    (void) curlsh;
+#endif
+
+    auto fd = open(c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return;
+        
+    /* An older file might have been created with the default umask */
+    fchmod(fd, S_IRUSR | S_IWUSR);
+    
+    auto str = writer.str();
+    auto p = str.data();
+    auto size = str.size();
+    
+    while (size > 0) {
+        auto n = ::write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+                
+            break;
+        }
+        
+        p += n;
+        size -= n;
+    }
+    
+    close(fd);
+    
+    _dirty = false;
+}
+
+std::shared_ptr<struct curl_slist> session_cache::resolve_list()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    auto now = std::time(nullptr);
+    
+    /* Long running processes must not keep outdated addresses */
+    if (now >= _next_expiry) {
+        auto it = _dns_map.begin();
+        
+        while (it != _dns_map.end()) {
+            if (it->second.expires > now) {
+                ++it;
+                continue;
+            }
+            
+            _removed.insert(it->first);
+            it = _dns_map.erase(it);
+            _dirty = true;
+        }
+        
+        update_resolve_list();
+    }
+    
+    return _resolve_list;
+}
+
+void session_cache::update(CURL *curl, CURLcode code)
+{
+    auto host = resolve_host(curl);
+    if (host.empty())
+        return;
+        
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    switch (code) {
+    case CURLE_OK:
+        break;
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SSL_CONNECT_ERROR:
+        /* The cached address might be outdated: look it up next time */
+        if (_dns_map.count(host) > 0) {
+            remove(host);
+            update_resolve_list();
+            _dirty = true;
+        }
+        /* fall through */
+    default:
+        return;
+    }
+    
+    char *ip = nullptr;
+    curl_off_t handshake = 0;
+    
+    curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &ip);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &handshake);
+    
+    /* A new TLS session was negotiated */
+    if (handshake > 0)
+        _dirty = true;
+        
+    if (!ip || *ip == '\0')
+        return;
+        
+    std::string address(ip);
+    
+    if (address.find(':') != std::string::npos)
+        address = "[" + address + "]";
+        
+    auto now = std::time(nullptr);
+    auto expires = now + _dns_ttl;
+    
+    /* 
+     * The address was confirmed: keep it for another 'dns_ttl' seconds.
+     * The file is only rewritten once half of the time has passed.
+     */
+    auto it = _dns_map.find(host);
+    if (it != _dns_map.end() && it->second.address == address) {
+        if (it->second.expires - now > _dns_ttl / 2)
+            return;
+    }
+    
+    auto entry = dns_entry { std::move(address), expires };
+    
+    _removed.erase(host);
+    _dns_map.erase(host);
+    _dns_map.insert({ std::move(host), std::move(entry) });
+    
+    update_resolve_list();
+    _dirty = true;
+}
+
+void session_cache::remove(const std::string &host)
+{
+    _dns_map.erase(host);
+    _removed.insert(host);
+}
+
+void session_cache::update_resolve_list()
+{
+    struct curl_slist *list = nullptr;
+    
+    auto append = [&list](const std::string &entry) {
+        auto new_list = curl_slist_append(list, entry.c_str());
+        if (!new_list) {
+            curl_slist_free_all(list);
+            throw std::runtime_error("curl_slist_append() failed.");
+        }
+        
+        list = new_list;
+    };
+    
+    /* 
+     * Addresses passed with CURLOPT_RESOLVE never time out of the DNS
+     * cache of curl: they have to be removed explicitly.
+     */
+    for (const auto &x : _removed)
+        append("-" + x);
+        
+    auto now = std::time(nullptr);
+    
+    _next_expiry = std::numeric_limits<std::time_t>::max();
+    
+    for (const auto &x : _dns_map) {
+        if (x.second.expires <= now)
+            continue;
+            
+        append(x.first + ":" + x.second.address);
+        
+        _next_expiry = std::min(_next_expiry, x.second.expires);
+    }
+    
+    /* Transfers which are in flight still hold a reference to the old list */
+    _resolve_list.reset(list, &curl_slist_free_all);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SESSION_CACHE_HPP_
+#define _SESSION_CACHE_HPP_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <ctime>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <curl/curl.h>
+
+#include "../file.hpp"
+
+/*
+ * Keeps resolved host addresses and, if libcurl is able to export them,
+ * TLS session tickets across multiple runs of tq. Addresses are handed
+ * to libcurl with CURLOPT_RESOLVE, so a new process can connect without
+ * a DNS lookup and resume its TLS session instead of doing a full
+ * handshake. Addresses are dropped from the list 'dns_ttl' seconds 
+ * after they were last confirmed by a transfer.
+ */
+class session_cache : public file {
+public:
+    session_cache(const std::string &path, unsigned int dns_ttl);
+    
+    void load(CURLSH *curlsh);
+    void save(CURLSH *curlsh);
+    
+    std::shared_ptr<struct curl_slist> resolve_list();
+    void update(CURL *curl, CURLcode code);
+private:
+    struct dns_entry {
+        std::string address;
+        std::time_t expires;
+    };
+    
+    void remove(const std::string &host);
+    void update_resolve_list();
+    
+    std::mutex _mutex;
+    std::unordered_map<std::string, dns_entry> _dns_map;
+    std::unordered_set<std::string> _removed;
+    std::shared_ptr<struct curl_slist> _resolve_list;
+    std::time_t _next_expiry;
+    unsigned int _dns_ttl;
+    bool _dirty;
+};
+
+#endif /* _SESSION_CACHE_HPP_ */
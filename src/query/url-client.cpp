@@ -20,16 +20,27 @@
 
 #include <utility>
 #include <stdexcept>
+#include <future>
+#include <mutex>
+#include <random>
+#include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <ctime>
 
 #include "url-client.hpp"
+#include "../tracer.hpp"
 
 #define CLIENT_ID "cdmq41iul8hs3ytq8i82p5s5g6ehyng"
 
-static size_t gather_response(char *p, 
-                              size_t size, 
-                              size_t nmemb, 
-                              std::string *str)
+/* Throttled requests are retried this often before giving up */
+#define MAX_RETRIES 4
+#define MAX_BACKOFF std::chrono::seconds(32)
+
+static size_t gather_header(char *p, 
+                            size_t size, 
+                            size_t nmemb, 
+                            std::string *str)
 {
     size_t total = size * nmemb;
     
@@ -38,107 +49,752 @@ static size_t gather_response(char *p,
     return total;
 }
 
-url_client::url_client(const std::string &client_id)
-    : url_client(client_id.c_str())
+/* Passes a complete body, e.g. from the cache, to any kind of handler */
+static void deliver(url_client::handler &handler, const std::string &body)
 {
+    if (!handler.streaming()) {
+        handler.response(std::string(body));
+        return;
+    }
+    
+    handler.write(body.data(), body.size());
+    handler.response(std::string());
 }
 
-url_client::url_client(const char *client_id)
-    : _header(),
-      _response(),
-      _curl(nullptr),
-      _curl_slist(nullptr)
+/* Somewhere between half and all of 2^attempt seconds */
+static std::chrono::milliseconds backoff(unsigned int attempt)
 {
-    curl_global::init();
+    static thread_local std::mt19937 engine(std::random_device{}());
     
-    auto client_id_header = std::string("Client-ID: ");
-    client_id_header += client_id;
+    auto max = std::chrono::milliseconds(1000) * (1 << attempt);
+    max = std::min<std::chrono::milliseconds>(max, MAX_BACKOFF);
+    
+    auto dist = std::uniform_int_distribution<long>(max.count() / 2, 
+                                                    max.count());
+                                                    
+    return std::chrono::milliseconds(dist(engine));
+}
+
+/* 
+ * Parses the number of seconds of "Retry-After" or "Ratelimit-Reset",
+ * which may also be given as a point in time. Returns the point in 
+ * time or the epoch, if 'str' is invalid.
+ */
+static std::chrono::system_clock::time_point parse_reset(const std::string &str)
+{
+    auto now = std::chrono::system_clock::now();
+    char *end = nullptr;
+    
+    auto val = std::strtoll(str.c_str(), &end, 10);
+    
+    if (end != str.c_str() && *end == '\0' && val >= 0) {
+        /* Large values are seconds since the epoch */
+        if (val > 1000000000LL)
+            return std::chrono::system_clock::from_time_t(val);
+            
+        return now + std::chrono::seconds(val);
+    }
     
-    curl_slist_add("Accept: application/vnd.twitchtv.v3+json");
-    curl_slist_add(client_id_header);
+    auto time = curl_getdate(str.c_str(), nullptr);
+    if (time < 0)
+        return std::chrono::system_clock::time_point();
+        
+    return std::chrono::system_clock::from_time_t(time);
+}
 
-    _curl = curl_easy_init();
-    if (!_curl) {
-        curl_slist_free_all(_curl_slist);
-        throw std::runtime_error("curl_easy_init() failed.");
+static void throw_if_failed(CURLcode code)
+{
+    if (code != CURLE_OK) {
+        std::string err("curl_easy_perform() failed - ");
+        err += "(";
+        err += std::to_string(code);
+        err += ") ";
+        err += curl_easy_strerror(code);
+ 
+        throw std::runtime_error(err);
+    }
+}
+
+static void throw_if_invalid(const http_header &header, 
+                             const std::string &str)
+{
+    auto type = header.get("content-type");
+    
+    for (auto &x : type)
+        x = std::tolower(x);
+    
+    if (type.compare(0, 16, "application/json") != 0)
+        throw std::runtime_error("Server sent invalid MIME type:\n" + str);
+}
+
+/* The end of each phase of a transfer in microseconds after its start */
+struct transfer_times {
+    curl_off_t dns;
+    curl_off_t connect;
+    curl_off_t tls;
+    curl_off_t start;
+    curl_off_t total;
+};
+
+static transfer_times get_times(CURL *curl)
+{
+    auto times = transfer_times { 0, 0, 0, 0, 0 };
+    
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &times.dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &times.connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &times.tls);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &times.start);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &times.total);
+    
+    /* Phases which did not happen, e.g. on a reused connection, are 0 */
+    times.connect = std::max(times.connect, times.dns);
+    times.tls = std::max(times.tls, times.connect);
+    times.start = std::max(times.start, times.tls);
+    times.total = std::max(times.total, times.start);
+    
+    return times;
+}
+
+/* "https://host/path?query" yields "/path" */
+static std::string url_path(const std::string &url)
+{
+    auto begin = url.find("://");
+    begin = url.find('/', (begin != std::string::npos) ? begin + 3 : 0);
+    
+    if (begin == std::string::npos)
+        return url;
+        
+    return url.substr(begin, url.find('?', begin) - begin);
+}
+
+/* Used to implement the blocking version of get_response() */
+class promise_handler : public url_client::handler {
+public:
+    promise_handler();
+    
+    std::future<std::string> get_future();
+    
+    virtual void response(std::string &&str) override;
+    virtual void error(std::exception_ptr ptr) override;
+private:
+    std::promise<std::string> _promise;
+};
+
+promise_handler::promise_handler()
+    : _promise()
+{
+}
+
+std::future<std::string> promise_handler::get_future()
+{
+    return _promise.get_future();
+}
+
+void promise_handler::response(std::string &&str)
+{
+    _promise.set_value(std::move(str));
+}
+
+void promise_handler::error(std::exception_ptr ptr)
+{
+    _promise.set_exception(ptr);
+}
+
+bool url_client::handler::streaming() const
+{
+    return false;
+}
+
+void url_client::handler::write(const char *data, std::size_t size)
+{
+    (void) data;
+    (void) size;
+}
+
+/* 
+ * Passes the response of one transfer on to all handlers which asked 
+ * for the same URL. Handlers can only join until the first piece of
+ * the response arrived.
+ */
+class url_client::fanout_handler : public url_client::handler {
+public:
+    explicit fanout_handler(std::shared_ptr<url_client::handler> handler);
+    
+    bool join(std::shared_ptr<url_client::handler> handler);
+    
+    virtual bool streaming() const override;
+    virtual void write(const char *data, std::size_t size) override;
+    
+    virtual void response(std::string &&str) override;
+    virtual void error(std::exception_ptr ptr) override;
+private:
+    void close();
+    
+    std::mutex _mutex;
+    std::vector<std::shared_ptr<url_client::handler>> _handlers;
+    bool _streaming;
+    bool _closed;
+};
+
+url_client::fanout_handler::fanout_handler(std::shared_ptr<handler> handler)
+    : _mutex(),
+      _handlers(),
+      _streaming(handler->streaming()),
+      _closed(false)
+{
+    _handlers.push_back(std::move(handler));
+}
+
+bool url_client::fanout_handler::join(std::shared_ptr<handler> handler)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    if (_closed || handler->streaming() != _streaming)
+        return false;
+        
+    _handlers.push_back(std::move(handler));
+    
+    return true;
+}
+
+bool url_client::fanout_handler::streaming() const
+{
+    return _streaming;
+}
+
+void url_client::fanout_handler::write(const char *data, std::size_t size)
+{
+    close();
+    
+    for (auto &x : _handlers)
+        x->write(data, size);
+}
+
+void url_client::fanout_handler::response(std::string &&str)
+{
+    close();
+    
+    for (std::size_t i = 1; i < _handlers.size(); ++i)
+        _handlers[i]->response(std::string(str));
+        
+    _handlers.front()->response(std::move(str));
+}
+
+void url_client::fanout_handler::error(std::exception_ptr ptr)
+{
+    close();
+    
+    for (auto &x : _handlers)
+        x->error(ptr);
+}
+
+void url_client::fanout_handler::close()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    _closed = true;
+}
+
+/* Drops the result of a transfer which only updates the response cache */
+class refresh_handler : public url_client::handler {
+public:
+    virtual void response(std::string &&str) override;
+    virtual void error(std::exception_ptr ptr) override;
+};
+
+void refresh_handler::response(std::string &&str)
+{
+    (void) str;
+}
+
+void refresh_handler::error(std::exception_ptr ptr)
+{
+    (void) ptr;
+}
+
+class url_client::transfer : public url_engine::transfer {
+public:
+    transfer(const std::string &url, 
+             const std::vector<std::string> &headers,
+             std::shared_ptr<url_client::handler> handler,
+             std::shared_ptr<response_cache> cache,
+             std::shared_ptr<rate_limiter> limiter,
+             std::shared_ptr<statistics> stats,
+             bool http2);
+    transfer(const transfer &other) = delete;
+    virtual ~transfer();
+    
+    virtual void complete(CURLcode code) override;
+    
+    transfer &operator=(const transfer &other) = delete;
+private:
+    static size_t write(char *p, size_t size, size_t nmemb, void *arg);
+    
+    void curl_slist_add(const std::string &info);
+    void update_stats();
+    void trace(CURLcode code) const;
+    
+    bool throttled() const;
+    void throttle(const http_header &header);
+    void retry_later(const http_header &header);
+    
+    struct curl_slist *_curl_slist;
+    std::shared_ptr<url_client::handler> _handler;
+    std::shared_ptr<response_cache> _cache;
+    std::shared_ptr<rate_limiter> _limiter;
+    std::shared_ptr<statistics> _stats;
+    std::string _url;
+    std::string _header;
+    std::string _response;
+    std::size_t _decoded;
+    std::exception_ptr _write_error;
+    std::chrono::steady_clock::time_point _queued;
+    unsigned int _attempt;
+    bool _streaming;
+    bool _keep_body;
+};
+
+url_client::transfer::transfer(const std::string &url, 
+                               const std::vector<std::string> &headers,
+                               std::shared_ptr<url_client::handler> handler,
+                               std::shared_ptr<response_cache> cache,
+                               std::shared_ptr<rate_limiter> limiter,
+                               std::shared_ptr<statistics> stats,
+                               bool http2)
+    : url_engine::transfer(),
+      _curl_slist(nullptr),
+      _handler(std::move(handler)),
+      _cache(std::move(cache)),
+      _limiter(std::move(limiter)),
+      _stats(std::move(stats)),
+      _url(url),
+      _header(),
+      _response(),
+      _decoded(0),
+      _write_error(),
+      _queued(std::chrono::steady_clock::now()),
+      _attempt(0),
+      _streaming(_handler->streaming()),
+      _keep_body(!_streaming || _cache)
+{
+    for (const auto &x : headers)
+        curl_slist_add(x);
+        
+    auto entry = response_cache::entry { "", "", 0, 0, nullptr };
+    
+    /* Only ask for the response if it changed since it was cached */
+    if (_cache && _cache->find(url, entry)) {
+        if (!entry.etag.empty())
+            curl_slist_add("If-None-Match: " + entry.etag);
+            
+        if (!entry.last_modified.empty())
+            curl_slist_add("If-Modified-Since: " + entry.last_modified);
     }
     
     int err = 0;
+    err |= curl_easy_setopt(_curl, CURLOPT_URL, _url.c_str());
     err |= curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, _curl_slist);
     err |= curl_easy_setopt(_curl, CURLOPT_FOLLOWLOCATION, 1L);
-    err |= curl_easy_setopt(_curl, CURLOPT_WRITEFUNCTION, &gather_response);
+    /* Offer all encodings libcurl can decode (gzip, deflate, br, ...) */
+    err |= curl_easy_setopt(_curl, CURLOPT_ACCEPT_ENCODING, "");
+    err |= curl_easy_setopt(_curl, CURLOPT_WRITEFUNCTION, &write);
+    err |= curl_easy_setopt(_curl, CURLOPT_HEADERFUNCTION, &gather_header);
     err |= curl_easy_setopt(_curl, CURLOPT_HEADERDATA, &_header);
-    err |= curl_easy_setopt(_curl, CURLOPT_WRITEDATA, &_response);
-    if (err) {
-        curl_easy_cleanup(_curl);
-        curl_slist_free_all(_curl_slist);
-        
-        throw std::runtime_error("curl_easy_setopt() failed.");
+    err |= curl_easy_setopt(_curl, CURLOPT_WRITEDATA, this);
+    
+    if (http2) {
+        /* Rather wait for a multiplexed stream than open a new connection */
+        err |= curl_easy_setopt(_curl, 
+                                CURLOPT_HTTP_VERSION, 
+                                CURL_HTTP_VERSION_2TLS);
+        err |= curl_easy_setopt(_curl, CURLOPT_PIPEWAIT, 1L);
     }
+    
+    if (err)
+        throw std::runtime_error("curl_easy_setopt() failed.");
 }
 
-url_client::~url_client()
+url_client::transfer::~transfer()
 {
-    curl_easy_cleanup(_curl);
+    /* The easy handle has to be released before the header list */
+    curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, nullptr);
     curl_slist_free_all(_curl_slist);
 }
 
-std::string url_client::get_response(const std::string &url)
+void url_client::transfer::complete(CURLcode code)
 {
-    _header.clear();
-    _response.clear();
+    update_stats();
+    trace(code);
     
-    curl_easy_setopt(_curl, CURLOPT_URL, url.c_str());
+    if (code == CURLE_OK && !_write_error) {
+        http_header header(_header);
+        
+        throttle(header);
+        
+        if (throttled()) {
+            _stats->retries += 1;
+            retry_later(header);
+            return;
+        }
+    }
     
-    auto ok = curl_easy_perform(_curl);
+    std::shared_ptr<const std::string> cached;
     
-    if (ok != CURLE_OK) {
-        std::string err("curl_easy_perform() failed - ");
-        err += "(";
-        err += std::to_string(ok);
-        err += ") ";
-        err += curl_easy_strerror(ok);
- 
-        throw std::runtime_error(err);
+    try {
+        if (_write_error)
+            std::rethrow_exception(_write_error);
+            
+        throw_if_failed(code);
+        
+        http_header header(_header);
+        long status = 0;
+        
+        curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &status);
+        
+        if (status == 304 && _cache) {
+            _stats->not_modified += 1;
+            cached = _cache->refresh(_url, header);
+            if (!cached)
+                throw std::runtime_error("Cached response for \"" + _url + 
+                                         "\" vanished.");
+        } else {
+            throw_if_invalid(header, _header);
+            
+            if (status == 200 && _cache)
+                _cache->store(_url, header, _response);
+        }
+    } catch (...) {
+        _handler->error(std::current_exception());
+        return;
+    }
+    
+    if (cached) {
+        deliver(*_handler, *cached);
+        return;
     }
+    
+    if (_streaming)
+        _response.clear();
+        
+    _handler->response(std::move(_response));
+}
 
-    for (auto &x : _header)
-        x = std::tolower(x);
+size_t url_client::transfer::write(char *p, 
+                                   size_t size, 
+                                   size_t nmemb, 
+                                   void *arg)
+{
+    auto self = static_cast<transfer *>(arg);
+    size_t total = size * nmemb;
+    
+    self->_decoded += total;
     
-    if (_header.find("content-type: application/json") == std::string::npos)
-        throw std::runtime_error("Server sent invalid MIME type:\n" + _header);
+    /* The body of a response which is retried is of no interest */
+    if (self->throttled())
+        return total;
+        
+    if (self->_keep_body)
+        self->_response.append(p, total);
+        
+    if (!self->_streaming)
+        return total;
         
-    return std::move(_response);
+    /* Exceptions must not unwind through libcurl */
+    try {
+        self->_handler->write(p, total);
+    } catch (...) {
+        self->_write_error = std::current_exception();
+        return 0;
+    }
+    
+    return total;
 }
 
-url_client::curl_global::curl_global()
+void url_client::transfer::curl_slist_add(const std::string &info)
 {
-    auto err = curl_global_init(CURL_GLOBAL_SSL);
-    if (err)
-        throw std::runtime_error("Failed to initialize curl_global");
+    auto new_list = curl_slist_append(_curl_slist, info.c_str());
+    if (!new_list)
+        throw std::runtime_error("curl_slist_append() failed.");
+        
+    _curl_slist = new_list;
 }
 
-url_client::curl_global::~curl_global()
+void url_client::transfer::update_stats()
 {
-    curl_global_cleanup();
+    curl_off_t received = 0;
+    long connections = 0;
+    
+    curl_easy_getinfo(_curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+    curl_easy_getinfo(_curl, CURLINFO_NUM_CONNECTS, &connections);
+    
+    auto times = get_times(_curl);
+    
+    _stats->transfers += 1;
+    _stats->connections += connections;
+    _stats->bytes_received += received;
+    _stats->bytes_decoded += _decoded;
+    
+    _stats->dns_usec += times.dns;
+    _stats->connect_usec += times.connect - times.dns;
+    _stats->tls_usec += times.tls - times.connect;
+    _stats->wait_usec += times.start - times.tls;
+    _stats->receive_usec += times.total - times.start;
 }
 
-void url_client::curl_global::init()
+void url_client::transfer::trace(CURLcode code) const
 {
-    static curl_global curl_global;
+    auto &tracer = tracer::shared();
+    
+    if (!tracer.enabled())
+        return;
+        
+    typedef std::chrono::microseconds usec;
+    
+    auto times = get_times(_curl);
+    auto end = std::chrono::steady_clock::now();
+    auto begin = std::max(end - usec(times.total), _queued);
+    long status = 0;
+    
+    curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &status);
+    
+    auto args = tracer::arg_vector {
+        { "url", _url },
+        { "status", std::to_string(status) },
+        { "attempt", std::to_string(_attempt + 1) },
+        { "result", curl_easy_strerror(code) },
+    };
+    
+    const struct {
+        const char *name;
+        curl_off_t begin;
+        curl_off_t end;
+    } phases[] = {
+        { "dns",     0,             times.dns     },
+        { "connect", times.dns,     times.connect },
+        { "tls",     times.connect, times.tls     },
+        { "server",  times.tls,     times.start   },
+        { "receive", times.start,   times.total   },
+    };
+    
+    auto name = url_path(_url);
+    auto id = tracer.next_id();
+    
+    tracer.async_begin(name, "request", id, _queued, args);
+    
+    /* Waiting for the rate limiter, a retry or a free connection */
+    if (begin > _queued) {
+        tracer.async_begin("queued", "request", id, _queued);
+        tracer.async_end("queued", "request", id, begin);
+    }
+    
+    for (const auto &x : phases) {
+        if (x.end <= x.begin)
+            continue;
+            
+        tracer.async_begin(x.name, "request", id, begin + usec(x.begin));
+        tracer.async_end(x.name, "request", id, begin + usec(x.end));
+    }
+    
+    tracer.async_end(name, "request", id, end);
 }
 
-void url_client::curl_slist_add(const std::string &info)
+bool url_client::transfer::throttled() const
 {
-    curl_slist_add(info.c_str());
+    long status = 0;
+    
+    if (_attempt >= MAX_RETRIES)
+        return false;
+        
+    curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &status);
+    
+    switch (status) {
+    case 429:
+    case 500:
+    case 502:
+    case 503:
+    case 504:
+        return true;
+    default:
+        return false;
+    }
 }
 
-void url_client::curl_slist_add(const char *info)
+void url_client::transfer::throttle(const http_header &header)
 {
-    auto new_list = curl_slist_append(_curl_slist, info);
-    if (!new_list)
-        throw std::runtime_error("curl_slist_append() failed.");
+    if (!_limiter || !header.has("ratelimit-remaining"))
+        return;
+        
+    /* The server does not accept any more requests until the reset */
+    if (std::atoll(header.get("ratelimit-remaining").c_str()) > 0)
+        return;
+        
+    if (header.has("ratelimit-reset"))
+        _limiter->block_until(parse_reset(header.get("ratelimit-reset")));
+}
+
+void url_client::transfer::retry_later(const http_header &header)
+{
+    auto delay = backoff(_attempt++);
     
-    _curl_slist = new_list;
+    if (header.has("retry-after")) {
+        auto time = parse_reset(header.get("retry-after"));
+        auto wait = time - std::chrono::system_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wait);
+        
+        delay = std::max(delay, ms);
+        
+        /* All other requests have to wait as well */
+        if (_limiter)
+            _limiter->block_until(time);
+    }
+    
+    if (_limiter)
+        delay = std::max(delay, _limiter->reserve());
+        
+    _header.clear();
+    _response.clear();
+    _decoded = 0;
+    _queued = std::chrono::steady_clock::now();
+    
+    retry(std::chrono::steady_clock::now() + delay);
+}
+
+url_client::url_client(const std::string &client_id)
+    : url_client(client_id.c_str())
+{
+}
+
+url_client::url_client(const char *client_id)
+    : _headers(),
+      _engine(url_engine::shared()),
+      _response_cache(),
+      _rate_limiter(),
+      _stats(std::make_shared<statistics>()),
+      _pending_mutex(),
+      _pending(),
+      _http2(false),
+      _stale_while_revalidate(false)
+{
+    auto client_id_header = std::string("Client-ID: ");
+    client_id_header += client_id;
+    
+    _headers.push_back("Accept: application/vnd.twitchtv.v3+json");
+    _headers.push_back(client_id_header);
+}
+
+url_client::~url_client()
+{
+}
+
+std::string url_client::get_response(const std::string &url)
+{
+    auto handler = std::make_shared<promise_handler>();
+    auto future = handler->get_future();
+    
+    get_response_async(url, std::move(handler));
+    
+    return future.get();
 }
 
+void url_client::get_response_async(const std::string &url, 
+                                    std::shared_ptr<handler> handler,
+                                    unsigned int ttl)
+{
+    auto entry = response_cache::entry { "", "", 0, 0, nullptr };
+    bool background = false;
+    
+    _stats->requests += 1;
+    
+    if (_response_cache && _response_cache->find(url, entry)) {
+        auto now = std::time(nullptr);
+        
+        if (entry.expires > now || entry.date + (std::time_t) ttl > now) {
+            _stats->cache_hits += 1;
+            deliver(*handler, *entry.body);
+            return;
+        }
+        
+        /* Answer with the stale response, the refreshed one is cached */
+        if (_stale_while_revalidate) {
+            _stats->cache_hits += 1;
+            deliver(*handler, *entry.body);
+            handler = std::make_shared<refresh_handler>();
+            background = true;
+        }
+    }
+    
+    /* Identical requests which are still pending share one transfer */
+    auto fanout = std::make_shared<fanout_handler>(handler);
+    
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        
+        auto it = _pending.find(url);
+        if (it != _pending.end()) {
+            auto pending = it->second.lock();
+            
+            if (pending && pending->join(handler)) {
+                _stats->coalesced += 1;
+                return;
+            }
+        }
+        
+        /* Forget about the transfers which are done */
+        for (auto it = _pending.begin(); it != _pending.end(); ) {
+            if (it->second.expired())
+                it = _pending.erase(it);
+            else
+                ++it;
+        }
+        
+        _pending[url] = fanout;
+    }
+    
+    auto unique = std::make_unique<transfer>(url, 
+                                             _headers, 
+                                             std::move(fanout), 
+                                             _response_cache,
+                                             _rate_limiter,
+                                             _stats,
+                                             _http2);
+    unique->set_background(background);
+    
+    if (_rate_limiter) {
+        auto delay = _rate_limiter->reserve();
+        unique->set_start_time(std::chrono::steady_clock::now() + delay);
+    }
+    
+    _engine->add(std::move(unique));
+}
+
+void url_client::set_http2(bool val)
+{
+    _http2 = val;
+}
+
+void url_client::set_stale_while_revalidate(bool val)
+{
+    _stale_while_revalidate = val;
+}
+
+void url_client::set_rate_limiter(std::shared_ptr<rate_limiter> limiter)
+{
+    _rate_limiter = std::move(limiter);
+}
+
+const url_client::statistics &url_client::stats() const
+{
+    return *_stats;
+}
+
+void url_client::set_session_cache(const std::string &path, 
+                                   unsigned int dns_ttl)
+{
+    _engine->load_session_cache(path, dns_ttl);
+}
+
+void url_client::set_response_cache(
+                                std::shared_ptr<response_cache> cache)
+{
+    _response_cache = std::move(cache);
+}
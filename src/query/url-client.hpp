@@ -22,38 +22,124 @@
 #define _URL_CLIENT_HPP_
 
 #include <string>
+#include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <unordered_map>
 
 #include <curl/curl.h>
 
+#include "url-engine.hpp"
+#include "rate-limiter.hpp"
+#include "response-cache.hpp"
+
 class url_client {
 public:
+    /* 
+     * Receives the result of an asynchronous request.
+     * Both functions are called from the worker thread of the url_engine
+     * or, if a fresh response is cached, from the calling thread.
+     */
+    class handler {
+    public:
+        virtual ~handler() = default;
+        
+        /* 
+         * A streaming handler receives the body piece by piece with
+         * write() while it is downloaded; response() is then called 
+         * with an empty string once the transfer succeeded.
+         */
+        virtual bool streaming() const;
+        virtual void write(const char *data, std::size_t size);
+        
+        virtual void response(std::string &&str) = 0;
+        virtual void error(std::exception_ptr ptr) = 0;
+    };
+    
+    /* Counters of all requests and transfers started by one client */
+    struct statistics {
+        std::atomic<unsigned long> requests;
+        std::atomic<unsigned long> cache_hits;
+        std::atomic<unsigned long> coalesced;
+        std::atomic<unsigned long> not_modified;
+        std::atomic<unsigned long> retries;
+        std::atomic<unsigned long> transfers;
+        std::atomic<unsigned long> connections;
+        
+        /* Size of the bodies on the wire and after decompression */
+        std::atomic<unsigned long> bytes_received;
+        std::atomic<unsigned long> bytes_decoded;
+        
+        /* Time spent in each phase of the transfers */
+        std::atomic<unsigned long long> dns_usec;
+        std::atomic<unsigned long long> connect_usec;
+        std::atomic<unsigned long long> tls_usec;
+        std::atomic<unsigned long long> wait_usec;
+        std::atomic<unsigned long long> receive_usec;
+    };
+    
     url_client(const std::string &client_id);
     url_client(const char *client_id);
     url_client(url_client &client) = delete;
     ~url_client();
     
     std::string get_response(const std::string &url);
+    /* 
+     * A cached response younger than 'ttl' seconds is used without
+     * asking the server, even if it is stale according to Cache-Control.
+     */
+    void get_response_async(const std::string &url, 
+                            std::shared_ptr<handler> handler,
+                            unsigned int ttl = 0);
+    
+    /* Negotiate HTTP/2 and multiplex concurrent requests, if possible */
+    void set_http2(bool val);
+    
+    /* 
+     * Resolved addresses and TLS sessions are kept in 'path' and
+     * reused by the next process.
+     */
+    void set_session_cache(const std::string &path, unsigned int dns_ttl);
+    
+    /* 
+     * Successful responses are stored in 'cache' and revalidated
+     * with conditional requests once they are stale.
+     */
+    void set_response_cache(std::shared_ptr<response_cache> cache);
+    
+    /* 
+     * Answer with a stale cached response right away and refresh 
+     * the cache in the background.
+     */
+    void set_stale_while_revalidate(bool val);
+    
+    /* 
+     * Requests wait for a token of 'limiter' before they are sent.
+     * Rate limits announced by the server block the limiter and 
+     * throttled requests (429 and 5xx) are retried with exponential
+     * backoff.
+     */
+    void set_rate_limiter(std::shared_ptr<rate_limiter> limiter);
+    
+    const statistics &stats() const;
     
     url_client &operator=(const url_client &client) = delete;
     
 private:
-    class curl_global {
-    public:
-        static void init();
-        
-    private:
-        explicit curl_global();
-        ~curl_global();
-    };
-    
-    void curl_slist_add(const std::string &info);
-    void curl_slist_add(const char *info);
+    class fanout_handler;
+    class transfer;
     
-    std::string _header;
-    std::string _response;
-    CURL *_curl;
-    struct curl_slist *_curl_slist;
+    std::vector<std::string> _headers;
+    std::shared_ptr<url_engine> _engine;
+    std::shared_ptr<response_cache> _response_cache;
+    std::shared_ptr<rate_limiter> _rate_limiter;
+    std::shared_ptr<statistics> _stats;
+    std::mutex _pending_mutex;
+    std::unordered_map<std::string, std::weak_ptr<fanout_handler>> _pending;
+    bool _http2;
+    bool _stale_while_revalidate;
 };
 
 #endif /* _URL_CLIENT_HPP_ */
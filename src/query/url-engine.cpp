@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+#include "url-engine.hpp"
+#include "../tracer.hpp"
+
+/* Time given to background transfers when the engine is destroyed */
+#define DRAIN_TIMEOUT std::chrono::seconds(5)
+
+url_engine::transfer::transfer()
+    : _curl(curl_easy_init()),
+      _resolve_list(),
+      _start_time(),
+      _background(false),
+      _retry(false)
+{
+    if (!_curl)
+        throw std::runtime_error("curl_easy_init() failed.");
+}
+
+url_engine::transfer::~transfer()
+{
+    curl_easy_cleanup(_curl);
+}
+
+CURL *url_engine::transfer::handle() const
+{
+    return _curl;
+}
+
+bool url_engine::transfer::background() const
+{
+    return _background;
+}
+
+void url_engine::transfer::set_background(bool val)
+{
+    _background = val;
+}
+
+void url_engine::transfer::set_start_time(
+                                std::chrono::steady_clock::time_point time)
+{
+    _start_time = time;
+}
+
+void url_engine::transfer::retry(std::chrono::steady_clock::time_point time)
+{
+    _start_time = time;
+    _retry = true;
+}
+
+url_engine::url_engine()
+    : _curlm(nullptr),
+      _curlsh(nullptr),
+      _share_mutex(),
+      _thread(),
+      _mutex(),
+      _queue(),
+      _delayed(),
+      _active(),
+      _session_cache(),
+      _deadline(),
+      _stop(false),
+      _exited(false)
+{
+    curl_global::init();
+    
+    _curlsh = curl_share_init();
+    if (!_curlsh)
+        throw std::runtime_error("curl_share_init() failed.");
+        
+    int err = 0;
+    err |= curl_share_setopt(_curlsh, CURLSHOPT_LOCKFUNC, &lock);
+    err |= curl_share_setopt(_curlsh, CURLSHOPT_UNLOCKFUNC, &unlock);
+    err |= curl_share_setopt(_curlsh, CURLSHOPT_USERDATA, this);
+    err |= curl_share_setopt(_curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    err |= curl_share_setopt(_curlsh, 
+                             CURLSHOPT_SHARE, 
+                             CURL_LOCK_DATA_SSL_SESSION);
+    err |= curl_share_setopt(_curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    if (err) {
+        curl_share_cleanup(_curlsh);
+        throw std::runtime_error("curl_share_setopt() failed.");
+    }
+    
+    _curlm = curl_multi_init();
+    if (!_curlm) {
+        curl_share_cleanup(_curlsh);
+        throw std::runtime_error("curl_multi_init() failed.");
+    }
+    
+    /* Allow HTTP/2 transfers to share a single connection */
+    curl_multi_setopt(_curlm, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+}
+
+url_engine::~url_engine()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _deadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+    }
+    
+    if (_thread.joinable()) {
+        curl_multi_wakeup(_curlm);
+        _thread.join();
+    }
+    
+    /* Transfers which never made it to the worker thread */
+    for (auto &x : _queue)
+        x->complete(CURLE_ABORTED_BY_CALLBACK);
+        
+    _queue.clear();
+    
+    save_session_cache();
+    
+    curl_multi_cleanup(_curlm);
+    curl_share_cleanup(_curlsh);
+}
+
+std::shared_ptr<url_engine> url_engine::shared()
+{
+    /* 
+     * The worker thread keeps tracing while the engine drains at exit:
+     * the tracer is created first so that it is destroyed last.
+     */
+    tracer::shared();
+    
+    static auto engine = std::make_shared<url_engine>();
+    
+    return engine;
+}
+
+void url_engine::add(std::unique_ptr<transfer> transfer)
+{
+    auto curl = transfer->handle();
+    
+    /* Keep idle connections in the pool alive between queries */
+    int err = 0;
+    err |= curl_easy_setopt(curl, CURLOPT_SHARE, _curlsh);
+    err |= curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    err |= curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
+    err |= curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
+    if (err)
+        throw std::runtime_error("curl_easy_setopt() failed.");
+        
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        
+        if (_session_cache) {
+            transfer->_resolve_list = _session_cache->resolve_list();
+            
+            auto list = transfer->_resolve_list.get();
+            curl_easy_setopt(curl, CURLOPT_RESOLVE, list);
+        }
+        
+        _queue.push_back(std::move(transfer));
+        
+        if (_exited) {
+            _thread.join();
+            _exited = false;
+        }
+        
+        if (!_thread.joinable())
+            _thread = std::thread(&url_engine::run, this);
+    }
+    
+    curl_multi_wakeup(_curlm);
+}
+
+void url_engine::load_session_cache(const std::string &path, 
+                                    unsigned int dns_ttl)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    /* The cache is loaded once and shared by all transfers */
+    if (_session_cache)
+        return;
+        
+    _session_cache = std::make_shared<session_cache>(path, dns_ttl);
+    _session_cache->load(_curlsh);
+}
+
+void url_engine::lock(CURL *curl, 
+                      curl_lock_data data, 
+                      curl_lock_access access, 
+                      void *arg)
+{
+    (void) curl;
+    (void) access;
+    
+    static_cast<url_engine *>(arg)->_share_mutex[data].lock();
+}
+
+void url_engine::unlock(CURL *curl, curl_lock_data data, void *arg)
+{
+    (void) curl;
+    
+    static_cast<url_engine *>(arg)->_share_mutex[data].unlock();
+}
+
+void url_engine::run()
+{
+    tracer::shared().set_thread_name("url engine");
+    
+    auto err = CURLM_OK;
+    
+    while (true) {
+        int running;
+        
+        add_queued();
+        
+        err = curl_multi_perform(_curlm, &running);
+        if (err != CURLM_OK)
+            break;
+            
+        read_info();
+        
+        if (_active.empty())
+            save_session_cache();
+            
+        if (drained())
+            break;
+        
+        err = curl_multi_poll(_curlm, nullptr, 0, poll_timeout(), nullptr);
+        if (err != CURLM_OK)
+            break;
+    }
+    
+    if (err == CURLM_OK) {
+        abort_all(true);
+        return;
+    }
+    
+    /* Nothing drives the transfers any more, fail them all */
+    auto code = (err == CURLM_OUT_OF_MEMORY) ? 
+        CURLE_OUT_OF_MEMORY : CURLE_FAILED_INIT;
+        
+    abort_all(true, code);
+    
+    while (true) {
+        std::vector<std::unique_ptr<transfer>> queue;
+        
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            
+            /* The next call to add() restarts the worker thread */
+            if (_queue.empty()) {
+                _exited = true;
+                return;
+            }
+            
+            queue.swap(_queue);
+        }
+        
+        for (auto &x : queue)
+            x->complete(code);
+    }
+}
+
+void url_engine::add_queued()
+{
+    auto queue = std::vector<std::unique_ptr<transfer>>();
+    
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::swap(queue, _queue);
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    
+    for (auto &x : queue)
+        _delayed.push_back(std::move(x));
+        
+    auto it = _delayed.begin();
+    
+    while (it != _delayed.end()) {
+        if ((*it)->_start_time > now) {
+            ++it;
+            continue;
+        }
+        
+        auto x = std::move(*it);
+        it = _delayed.erase(it);
+        
+        auto curl = x->handle();
+        
+        auto err = curl_multi_add_handle(_curlm, curl);
+        if (err != CURLM_OK) {
+            x->complete(CURLE_FAILED_INIT);
+            continue;
+        }
+        
+        _active[curl] = std::move(x);
+    }
+}
+
+void url_engine::read_info()
+{
+    std::shared_ptr<session_cache> cache;
+    CURLMsg *msg;
+    int n;
+    
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        cache = _session_cache;
+    }
+    
+    while ((msg = curl_multi_info_read(_curlm, &n))) {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+            
+        /* 'msg' is invalid as soon as the handle is removed */
+        auto curl = msg->easy_handle;
+        auto code = msg->data.result;
+        
+        curl_multi_remove_handle(_curlm, curl);
+        
+        auto it = _active.find(curl);
+        if (it == _active.end())
+            continue;
+            
+        if (cache)
+            cache->update(curl, code);
+            
+        auto transfer = std::move(it->second);
+        _active.erase(it);
+        
+        transfer->complete(code);
+        
+        if (transfer->_retry) {
+            transfer->_retry = false;
+            _delayed.push_back(std::move(transfer));
+        }
+    }
+}
+
+long url_engine::poll_timeout() const
+{
+    auto now = std::chrono::steady_clock::now();
+    auto timeout = std::chrono::milliseconds(1000);
+    
+    /* Wake up in time for the next delayed transfer */
+    for (const auto &x : _delayed) {
+        auto wait = x->_start_time - now;
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wait);
+        
+        timeout = std::min(timeout, ms + std::chrono::milliseconds(1));
+    }
+    
+    return std::max(timeout.count(), 0L);
+}
+
+bool url_engine::drained()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        
+        if (!_stop)
+            return false;
+            
+        if (std::chrono::steady_clock::now() >= _deadline)
+            return true;
+    }
+    
+    /* Nobody waits for the result of a foreground transfer any more */
+    abort_all(false);
+    
+    return _active.empty() && _delayed.empty();
+}
+
+void url_engine::abort_all(bool background, CURLcode code)
+{
+    auto it = _active.begin();
+    
+    while (it != _active.end()) {
+        if (it->second->background() && !background) {
+            ++it;
+            continue;
+        }
+        
+        curl_multi_remove_handle(_curlm, it->first);
+        it->second->complete(code);
+        
+        it = _active.erase(it);
+    }
+    
+    auto delayed = _delayed.begin();
+    
+    while (delayed != _delayed.end()) {
+        if ((*delayed)->background() && !background) {
+            ++delayed;
+            continue;
+        }
+        
+        (*delayed)->complete(code);
+        
+        delayed = _delayed.erase(delayed);
+    }
+}
+
+void url_engine::save_session_cache()
+{
+    std::shared_ptr<session_cache> cache;
+    
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        cache = _session_cache;
+    }
+    
+    if (cache)
+        cache->save(_curlsh);
+}
+
+url_engine::curl_global::curl_global()
+{
+    auto err = curl_global_init(CURL_GLOBAL_SSL);
+    if (err)
+        throw std::runtime_error("Failed to initialize curl_global");
+}
+
+url_engine::curl_global::~curl_global()
+{
+    curl_global_cleanup();
+}
+
+void url_engine::curl_global::init()
+{
+    static curl_global curl_global;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _URL_ENGINE_HPP_
+#define _URL_ENGINE_HPP_
+
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "session-cache.hpp"
+
+/*
+ * Runs any number of curl easy handles concurrently on a curl multi handle.
+ * The transfers are driven by a worker thread which is started as soon
+ * as the first transfer is added. Completed transfers are reported
+ * on the worker thread.
+ *
+ * Background transfers are not aborted when the engine is destroyed,
+ * instead they get a few seconds to complete. Transfers with a start
+ * time in the future are held back until it has come.
+ *
+ * All transfers of the process should go through the shared() engine:
+ * connections, DNS lookups and TLS sessions are pooled in a curl share
+ * handle and HTTP/2 streams can only be multiplexed on connections
+ * held by the same multi handle.
+ */
+class url_engine {
+public:
+    class transfer {
+    public:
+        transfer();
+        transfer(const transfer &other) = delete;
+        virtual ~transfer();
+        
+        CURL *handle() const;
+        
+        bool background() const;
+        void set_background(bool val);
+        
+        /* The transfer is not started before 'time' */
+        void set_start_time(std::chrono::steady_clock::time_point time);
+        
+        /* 
+         * Called by complete() to run the same transfer again at 'time'
+         * instead of releasing it.
+         */
+        void retry(std::chrono::steady_clock::time_point time);
+        
+        virtual void complete(CURLcode code) = 0;
+        
+        transfer &operator=(const transfer &other) = delete;
+    protected:
+        CURL *_curl;
+    private:
+        friend class url_engine;
+        
+        std::shared_ptr<struct curl_slist> _resolve_list;
+        std::chrono::steady_clock::time_point _start_time;
+        bool _background;
+        bool _retry;
+    };
+    
+    url_engine();
+    url_engine(const url_engine &other) = delete;
+    ~url_engine();
+    
+    static std::shared_ptr<url_engine> shared();
+    
+    void add(std::unique_ptr<transfer> transfer);
+    
+    void load_session_cache(const std::string &path, unsigned int dns_ttl);
+    
+    url_engine &operator=(const url_engine &other) = delete;
+private:
+    class curl_global {
+    public:
+        static void init();
+        
+    private:
+        explicit curl_global();
+        ~curl_global();
+    };
+    
+    static void lock(CURL *curl, 
+                     curl_lock_data data, 
+                     curl_lock_access access, 
+                     void *arg);
+    static void unlock(CURL *curl, curl_lock_data data, void *arg);
+    
+    void run();
+    void add_queued();
+    void read_info();
+    long poll_timeout() const;
+    bool drained();
+    void abort_all(bool background, 
+                   CURLcode code = CURLE_ABORTED_BY_CALLBACK);
+    void save_session_cache();
+    
+    CURLM *_curlm;
+    CURLSH *_curlsh;
+    std::mutex _share_mutex[CURL_LOCK_DATA_LAST];
+    std::thread _thread;
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<transfer>> _queue;
+    std::vector<std::unique_ptr<transfer>> _delayed;
+    std::unordered_map<CURL *, std::unique_ptr<transfer>> _active;
+    std::shared_ptr<session_cache> _session_cache;
+    std::chrono::steady_clock::time_point _deadline;
+    bool _stop;
+    bool _exited;
+};
+
+#endif /* _URL_ENGINE_HPP_ */
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <utility>
+
+#include "result-queue.hpp"
+
+result_queue::state::state()
+    : mutex(),
+      ready_cond(),
+      results(),
+      taken(),
+      ready()
+{
+}
+
+result_queue::result_queue()
+    : _state(std::make_shared<state>()),
+      _next(0),
+      _pending(0)
+{
+}
+
+query_adapter::completion result_queue::add()
+{
+    auto state = _state;
+    std::size_t index;
+    
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        
+        index = state->results.size();
+        state->results.emplace_back();
+        state->taken.push_back(false);
+    }
+    
+    ++_pending;
+    
+    return [state, index](result_future res) {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            
+            state->results[index] = std::move(res);
+            state->ready.push_back(index);
+        }
+        
+        state->ready_cond.notify_one();
+    };
+}
+
+std::size_t result_queue::pending() const
+{
+    return _pending;
+}
+
+result_queue::result_future result_queue::take_next()
+{
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    
+    while (_next < _state->taken.size() && _state->taken[_next])
+        ++_next;
+        
+    if (_next == _state->taken.size())
+        throw std::logic_error("No pending result to take.");
+        
+    auto &res = _state->results[_next];
+    
+    _state->ready_cond.wait(lock, [&res]() { return res.valid(); });
+    _state->taken[_next] = true;
+    --_pending;
+    
+    return std::move(res);
+}
+
+result_queue::result_future result_queue::take_any()
+{
+    if (_pending == 0)
+        throw std::logic_error("No pending result to take.");
+        
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    
+    while (true) {
+        _state->ready_cond.wait(lock, [this]() { 
+            return !_state->ready.empty(); 
+        });
+        
+        auto index = _state->ready.front();
+        _state->ready.pop_front();
+        
+        /* Taken by take_next() in the meantime */
+        if (_state->taken[index])
+            continue;
+            
+        _state->taken[index] = true;
+        --_pending;
+        
+        return std::move(_state->results[index]);
+    }
+}
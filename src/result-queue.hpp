@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RESULT_QUEUE_HPP_
+#define _RESULT_QUEUE_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "adapter/query-adapter.hpp"
+
+/*
+ * Receives the results of the queries which were issued with a 
+ * completion from add(). The results can be taken in the order the 
+ * queries were issued or in the order they became ready. A waiting 
+ * thread sleeps until the next result arrives.
+ */
+class result_queue {
+public:
+    typedef query_adapter::result_future result_future;
+    
+    result_queue();
+    result_queue(const result_queue &other) = delete;
+    
+    /* Returns the completion of the next query to issue */
+    query_adapter::completion add();
+    
+    /* The number of results which were not taken yet */
+    std::size_t pending() const;
+    
+    /* Waits for the result of the oldest query not taken yet */
+    result_future take_next();
+    
+    /* Waits for any result which was not taken yet */
+    result_future take_any();
+    
+    result_queue &operator=(const result_queue &other) = delete;
+private:
+    /* Outlives the queue if it is left before all results arrived */
+    struct state {
+        state();
+        
+        std::mutex mutex;
+        std::condition_variable ready_cond;
+        
+        /* Indexed by query, invalid until its result arrived */
+        std::vector<result_future> results;
+        std::vector<bool> taken;
+        
+        /* The queries in the order their results arrived */
+        std::deque<std::size_t> ready;
+    };
+    
+    std::shared_ptr<state> _state;
+    std::size_t _next;
+    std::size_t _pending;
+};
+
+#endif /* _RESULT_QUEUE_HPP_ */
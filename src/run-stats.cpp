@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <iomanip>
+
+#include "run-stats.hpp"
+#include "tracer.hpp"
+
+static std::atomic<unsigned long long> stage_count[run_stats::STAGE_MAX];
+static std::atomic<unsigned long long> stage_nsec[run_stats::STAGE_MAX];
+static std::atomic<unsigned long long> alloc_count;
+static std::atomic<unsigned long long> alloc_bytes;
+
+static const char *stage_names[] = {
+    "config",
+    "files",
+    "parse",
+    "dump",
+};
+
+static void dump_row(std::ostream &out, 
+                     const char *name, 
+                     unsigned long long count,
+                     unsigned long long usec)
+{
+    out << "  " << std::setw(12) << std::left << name 
+        << std::setw(10) << std::right << count
+        << std::setw(14) << std::right << usec / 1000.0 << "\n";
+}
+
+run_stats::timer::timer(stage stage)
+    : _stage(stage),
+      _start(std::chrono::steady_clock::now())
+{
+}
+
+run_stats::timer::~timer()
+{
+    auto end = std::chrono::steady_clock::now();
+    
+    run_stats::add(_stage, end - _start);
+    tracer::shared().span(stage_names[_stage], "tq", _start, end);
+}
+
+run_stats::run_stats()
+    : _start(current()),
+      _start_time(std::chrono::steady_clock::now())
+{
+}
+
+void run_stats::add(stage stage, std::chrono::steady_clock::duration time)
+{
+    auto nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(time);
+    
+    stage_count[stage].fetch_add(1, std::memory_order_relaxed);
+    stage_nsec[stage].fetch_add(nsec.count(), std::memory_order_relaxed);
+}
+
+void run_stats::count_allocation(std::size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void run_stats::dump(std::ostream &out, 
+                     const url_client::statistics &net) const
+{
+    auto now = current();
+    auto wall = std::chrono::steady_clock::now() - _start_time;
+    auto wall_usec = 
+        std::chrono::duration_cast<std::chrono::microseconds>(wall).count();
+        
+    auto flags = out.flags();
+    auto precision = out.precision();
+    
+    out << std::fixed << std::setprecision(3);
+    
+    out << "[ Statistics ]:\n"
+        << "  " << std::setw(12) << std::left << "Stage" 
+        << std::setw(10) << std::right << "Count" 
+        << std::setw(14) << std::right << "Time [ms]" << "\n"
+        << std::setfill('-') << std::setw(38) << "" << std::setfill(' ') 
+        << "\n";
+        
+    for (int i = 0; i < STAGE_MAX; ++i) {
+        auto count = now.count[i] - _start.count[i];
+        auto usec = (now.nsec[i] - _start.nsec[i]) / 1000;
+        
+        dump_row(out, stage_names[i], count, usec);
+    }
+    
+    /* The network phases of all transfers, which may overlap */
+    dump_row(out, "dns", net.transfers, net.dns_usec);
+    dump_row(out, "connect", net.transfers, net.connect_usec);
+    dump_row(out, "tls", net.transfers, net.tls_usec);
+    dump_row(out, "server", net.transfers, net.wait_usec);
+    dump_row(out, "receive", net.transfers, net.receive_usec);
+    dump_row(out, "wall", 1, wall_usec);
+    
+    out << "\n"
+        << "  Requests    : " << net.requests << " (" 
+        << net.cache_hits << " cached, " 
+        << net.coalesced << " coalesced, "
+        << net.not_modified << " not modified, "
+        << net.retries << " retried)\n"
+        << "  Transfers   : " << net.transfers << " on " 
+        << net.connections << " new connections\n"
+        << "  Bytes       : " << net.bytes_received << " received, " 
+        << net.bytes_decoded << " decoded\n"
+        << "  Allocations : " << now.allocs - _start.allocs << " (" 
+        << now.alloc_bytes - _start.alloc_bytes << " bytes)\n";
+        
+    out.flags(flags);
+    out.precision(precision);
+}
+
+run_stats::totals run_stats::current()
+{
+    totals totals;
+    
+    for (int i = 0; i < STAGE_MAX; ++i) {
+        totals.count[i] = stage_count[i].load(std::memory_order_relaxed);
+        totals.nsec[i] = stage_nsec[i].load(std::memory_order_relaxed);
+    }
+    
+    totals.allocs = alloc_count.load(std::memory_order_relaxed);
+    totals.alloc_bytes = alloc_bytes.load(std::memory_order_relaxed);
+    
+    return totals;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUN_STATS_HPP_
+#define _RUN_STATS_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#include "query/url-client.hpp"
+
+/*
+ * Measures where the time of a run is spent. The client side stages are
+ * timed with a run_stats::timer wherever they happen, on any thread, and
+ * summed up for the whole process. Allocations are only counted if
+ * the program replaces the global operator new with one that calls
+ * count_allocation(), which tq does in alloc-counter.cpp.
+ *
+ * A run_stats object remembers the totals at its construction, so a 
+ * long running process (e.g. the daemon) reports each run on its own.
+ */
+class run_stats {
+public:
+    enum stage {
+        STAGE_CONFIG,
+        STAGE_FILES,
+        STAGE_PARSE,
+        STAGE_DUMP,
+        STAGE_MAX,
+    };
+    
+    class timer {
+    public:
+        explicit timer(stage stage);
+        timer(const timer &other) = delete;
+        ~timer();
+        
+        timer &operator=(const timer &other) = delete;
+    private:
+        stage _stage;
+        std::chrono::steady_clock::time_point _start;
+    };
+    
+    run_stats();
+    
+    static void add(stage stage, std::chrono::steady_clock::duration time);
+    static void count_allocation(std::size_t size);
+    
+    /* Prints the summary of the run including the transfers of 'net' */
+    void dump(std::ostream &out, const url_client::statistics &net) const;
+private:
+    struct totals {
+        unsigned long long count[STAGE_MAX];
+        unsigned long long nsec[STAGE_MAX];
+        unsigned long long allocs;
+        unsigned long long alloc_bytes;
+    };
+    
+    static totals current();
+    
+    totals _start;
+    std::chrono::steady_clock::time_point _start_time;
+};
+
+#endif /* _RUN_STATS_HPP_ */
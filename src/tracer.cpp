@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "tracer.hpp"
+
+static void write_string(std::ostream &out, const std::string &str)
+{
+    out << '"';
+    
+    for (auto c : str) {
+        switch (c) {
+        case '"':
+        case '\\':
+            out << '\\' << c;
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        default:
+            if ((unsigned char) c >= 0x20)
+                out << c;
+            break;
+        }
+    }
+    
+    out << '"';
+}
+
+tracer::tracer()
+    : _mutex(),
+      _events(),
+      _path(),
+      _start(clock::now()),
+      _enabled(false),
+      _next_id(1)
+{
+}
+
+tracer &tracer::shared()
+{
+    static tracer tracer;
+    
+    return tracer;
+}
+
+void tracer::start(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    _path = path;
+    _events.clear();
+    _events.reserve(1024);
+    _enabled = true;
+}
+
+void tracer::stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    if (!_enabled)
+        return;
+        
+    _enabled = false;
+    
+    std::ofstream file(_path, std::ios::out | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Unable to write trace \"" + _path + "\".");
+        
+    auto pid = getpid();
+    auto first = true;
+    
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    
+    for (const auto &x : _events) {
+        if (!first)
+            file << ",\n";
+            
+        first = false;
+        
+        file << "{\"name\":";
+        write_string(file, x.name);
+        file << ",\"cat\":\"" << x.category << "\""
+             << ",\"ph\":\"" << x.phase << "\""
+             << ",\"ts\":" << x.time
+             << ",\"pid\":" << pid
+             << ",\"tid\":" << x.thread;
+             
+        if (x.phase == 'X')
+            file << ",\"dur\":" << x.duration;
+            
+        if (x.phase == 'b' || x.phase == 'e')
+            file << ",\"id\":" << x.id;
+            
+        if (!x.args.empty()) {
+            file << ",\"args\":{";
+            
+            for (std::size_t i = 0; i < x.args.size(); ++i) {
+                file << ((i > 0) ? ",\"" : "\"") << x.args[i].first << "\":";
+                write_string(file, x.args[i].second);
+            }
+            
+            file << "}";
+        }
+        
+        file << "}";
+    }
+    
+    file << "\n]}\n";
+    
+    _events.clear();
+}
+
+bool tracer::enabled() const
+{
+    return _enabled;
+}
+
+void tracer::set_thread_name(const std::string &name)
+{
+    if (!_enabled)
+        return;
+        
+    add(event { "thread_name", "__metadata", 'M', 0, 0, thread_id(), 0, 
+                arg_vector { { "name", name } } });
+}
+
+unsigned long long tracer::next_id()
+{
+    return _next_id++;
+}
+
+void tracer::span(const std::string &name, 
+                  const char *category,
+                  clock::time_point begin,
+                  clock::time_point end,
+                  const arg_vector &args)
+{
+    if (!_enabled)
+        return;
+        
+    auto time = usec(begin);
+    
+    add(event { name, category, 'X', time, usec(end) - time, thread_id(), 
+                0, args });
+}
+
+void tracer::async_begin(const std::string &name,
+                         const char *category,
+                         unsigned long long id,
+                         clock::time_point time,
+                         const arg_vector &args)
+{
+    if (!_enabled)
+        return;
+        
+    add(event { name, category, 'b', usec(time), 0, thread_id(), id, args });
+}
+
+void tracer::async_end(const std::string &name,
+                       const char *category,
+                       unsigned long long id,
+                       clock::time_point time)
+{
+    if (!_enabled)
+        return;
+        
+    add(event { name, category, 'e', usec(time), 0, thread_id(), id, 
+                arg_vector() });
+}
+
+unsigned int tracer::thread_id()
+{
+    static std::atomic<unsigned int> next(1);
+    static thread_local unsigned int id = next++;
+    
+    return id;
+}
+
+long long tracer::usec(clock::time_point time) const
+{
+    auto diff = time - _start;
+    
+    return std::chrono::duration_cast<std::chrono::microseconds>(diff).count();
+}
+
+void tracer::add(event &&event)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    if (_enabled)
+        _events.push_back(std::move(event));
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TRACER_HPP_
+#define _TRACER_HPP_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+/*
+ * Collects spans in the Chrome trace event format, which can be viewed
+ * with chrome://tracing or Perfetto. Synchronous spans belong to the
+ * thread which recorded them, asynchronous spans (e.g. transfers) may
+ * overlap and are grouped by their id. Nothing is recorded until the 
+ * tracer is started; the events are written to the file on stop().
+ */
+class tracer {
+public:
+    typedef std::chrono::steady_clock clock;
+    typedef std::vector<std::pair<const char *, std::string>> arg_vector;
+    
+    tracer();
+    tracer(const tracer &other) = delete;
+    
+    static tracer &shared();
+    
+    void start(const std::string &path);
+    void stop();
+    
+    bool enabled() const;
+    
+    /* Names the calling thread in the trace */
+    void set_thread_name(const std::string &name);
+    
+    unsigned long long next_id();
+    
+    void span(const std::string &name, 
+              const char *category,
+              clock::time_point begin,
+              clock::time_point end,
+              const arg_vector &args = arg_vector());
+    
+    /* Spans with the same id nest if they are added in order */
+    void async_begin(const std::string &name,
+                     const char *category,
+                     unsigned long long id,
+                     clock::time_point time,
+                     const arg_vector &args = arg_vector());
+    void async_end(const std::string &name,
+                   const char *category,
+                   unsigned long long id,
+                   clock::time_point time);
+                    
+    tracer &operator=(const tracer &other) = delete;
+private:
+    struct event {
+        std::string name;
+        const char *category;
+        char phase;
+        long long time;
+        long long duration;
+        unsigned int thread;
+        unsigned long long id;
+        arg_vector args;
+    };
+    
+    static unsigned int thread_id();
+    
+    long long usec(clock::time_point time) const;
+    void add(event &&event);
+    
+    std::mutex _mutex;
+    std::vector<event> _events;
+    std::string _path;
+    clock::time_point _start;
+    std::atomic<bool> _enabled;
+    std::atomic<unsigned long long> _next_id;
+};
+
+#endif /* _TRACER_HPP_ */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+#include "watcher.hpp"
+
+/* Channels which stay offline are polled at most this much less often */
+#define MAX_BACKOFF 16
+
+static unsigned int local_hour()
+{
+    auto now = std::time(nullptr);
+    struct tm tm;
+    
+    if (!localtime_r(&now, &tm))
+        return 0;
+        
+    return tm.tm_hour;
+}
+
+watcher::channel_state::channel_state()
+    : due(),
+      interval(),
+      hours()
+{
+}
+
+watcher::watcher(query_adapter &adapter, const ::bookmarks &bookmarks)
+    : _adapter(adapter),
+      _bookmarks(bookmarks),
+      _states(),
+      _live(),
+      _interval(std::chrono::seconds(60)),
+      _viewer_delta(0)
+{
+}
+
+void watcher::set_interval(unsigned int interval)
+{
+    if (interval == 0)
+        throw std::invalid_argument("Invalid watch interval \"0\"");
+        
+    _interval = std::chrono::seconds(interval);
+}
+
+void watcher::set_viewer_delta(unsigned int delta)
+{
+    _viewer_delta = delta;
+}
+
+void watcher::seed(const bookmarks_result &res)
+{
+    const auto &channels = res.channels();
+    
+    for (const auto &x : channels) {
+        auto it = _states.find(x);
+        if (it == _states.end()) {
+            it = _states.insert({ x, channel_state() }).first;
+            it->second.interval = _interval;
+        }
+    }
+    
+    res.live_streams(_live);
+    schedule(channels, clock::now());
+}
+
+void watcher::run(std::ostream &out, std::ostream &err)
+{
+    /* 
+     * Polls only happen on a fixed grid of ticks, so channels which 
+     * are due at the same tick share their requests.
+     */
+    auto tick = clock::now();
+    
+    while (true) {
+        auto channels = due_channels(tick);
+        
+        if (!channels.empty()) {
+            try {
+                auto res = _adapter.bookmarks(channels).get();
+                
+                auto bookmarks = dynamic_cast<bookmarks_result *>(res.get());
+                if (bookmarks) {
+                    bookmarks->dump_changes(out, _live, _viewer_delta);
+                    schedule(channels, tick);
+                } else {
+                    /* The server sent an error: try again later */
+                    res->dump(err);
+                    postpone(channels, tick);
+                }
+            } catch (std::invalid_argument &e) {
+                /* The same lookup would fail again on every tick */
+                throw;
+            } catch (std::exception &e) {
+                err << "Exception: " << e.what() << std::endl;
+                postpone(channels, tick);
+            }
+            
+            out.flush();
+        }
+        
+        /* Skip the ticks which were missed by a slow poll */
+        auto now = clock::now();
+        
+        do {
+            tick += _interval;
+        } while (tick <= now);
+        
+        std::this_thread::sleep_until(tick);
+    }
+}
+
+std::vector<std::string> watcher::due_channels(clock::time_point now)
+{
+    auto channels = std::vector<std::string>();
+    
+    /* Bookmarks added in the meantime are due at once */
+    auto bookmarks = _bookmarks.get();
+    auto names = std::unordered_set<std::string>(bookmarks.begin(), 
+                                                 bookmarks.end());
+                                                 
+    for (const auto &x : bookmarks) {
+        auto it = _states.find(x);
+        if (it == _states.end()) {
+            it = _states.insert({ x, channel_state() }).first;
+            it->second.interval = _interval;
+        }
+        
+        if (it->second.due <= now)
+            channels.push_back(x);
+    }
+    
+    /* Forget about removed bookmarks */
+    for (auto it = _states.begin(); it != _states.end(); ) {
+        if (names.count(it->first) == 0) {
+            _live.erase(it->first);
+            it = _states.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    return channels;
+}
+
+void watcher::schedule(const std::vector<std::string> &channels, 
+                       clock::time_point now)
+{
+    auto hour = local_hour();
+    auto next_hour = (hour + 1) % 24;
+    auto max_interval = _interval * MAX_BACKOFF;
+    
+    for (const auto &x : channels) {
+        auto &state = _states[x];
+        
+        if (_live.count(x) > 0) {
+            state.hours.set(hour);
+            state.interval = _interval;
+        } else if (state.hours.test(hour) || state.hours.test(next_hour)) {
+            /* The channel usually goes live around this time */
+            state.interval = _interval;
+        } else {
+            state.interval = std::min(2 * state.interval, max_interval);
+        }
+        
+        state.due = now + state.interval;
+    }
+}
+
+void watcher::postpone(const std::vector<std::string> &channels, 
+                       clock::time_point now)
+{
+    for (const auto &x : channels)
+        _states[x].due = now + _interval;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016  Steffen Nüssle
+ * tq - Twitch Query
+ *
+ * This file is part of tq.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WATCHER_HPP_
+#define _WATCHER_HPP_
+
+#include <bitset>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bookmarks.hpp"
+#include "adapter/query-adapter.hpp"
+
+/*
+ * Keeps polling the bookmarked streams and prints only what changed
+ * since the previous poll: streams which went live or offline, changed
+ * their game or gained or lost more than a number of viewers. The 
+ * first poll reports every live stream which was not seeded before.
+ *
+ * Every channel is polled on its own schedule. Live channels and 
+ * channels which were live around this hour of the day before are 
+ * polled at the watch interval, all others back off up to a multiple 
+ * of it. Channels which are due at the same time share their requests.
+ */
+class watcher {
+public:
+    watcher(query_adapter &adapter, const ::bookmarks &bookmarks);
+    
+    void set_interval(unsigned int interval);
+    void set_viewer_delta(unsigned int delta);
+    
+    /* Takes the state of the channels from a lookup made before run() */
+    void seed(const bookmarks_result &res);
+    
+    /* 
+     * Never returns, unless a lookup was rejected as invalid. Failed 
+     * requests are retried at the next tick.
+     */
+    void run(std::ostream &out, std::ostream &err);
+private:
+    typedef std::chrono::steady_clock clock;
+    
+    struct channel_state {
+        channel_state();
+        
+        clock::time_point due;
+        clock::duration interval;
+        
+        /* The hours of the day the channel was seen live */
+        std::bitset<24> hours;
+    };
+    
+    std::vector<std::string> due_channels(clock::time_point now);
+    void schedule(const std::vector<std::string> &channels, 
+                  clock::time_point now);
+    void postpone(const std::vector<std::string> &channels, 
+                  clock::time_point now);
+    
+    query_adapter &_adapter;
+    const ::bookmarks &_bookmarks;
+    std::unordered_map<std::string, channel_state> _states;
+    bookmarks_result::live_map _live;
+    clock::duration _interval;
+    unsigned int _viewer_delta;
+};
+
+#endif /* _WATCHER_HPP_ */